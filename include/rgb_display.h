@@ -1,5 +1,6 @@
 #pragma once
 #include <stdint.h>
+#include <stdbool.h>
 
 #define DISPLAY_COLS 128
 #define DISPLAY_ROWS 37
@@ -17,8 +18,19 @@ typedef struct {
 // Screen modes (DOS-compatible constants)
 typedef enum {
     SM_TEXT   = 3,      // Text mode (128x37 chars)
+    SM_CGA4   = 4,      // CGA mode 04h: 320x200 @ 2bpp, 4 colours, interlaced banks
     SM_VGA13H = 0x13,   // VGA mode 13h: 320x200 @ 8bpp (256 colors)
     SM_150P   = 0x80,   // Custom mode: 256x150 @ 8bpp (256 colors)
+    SM_EXTERNAL = 0x81, // Application-owned 8bpp framebuffer (rgb_display_set_external_framebuffer)
+    SM_CUSTOM = 0x82,   // Any resolution @ 8bpp, nearest-neighbour scaled (rgb_display_set_custom_mode)
+    SM_MONO   = 0x83,   // 1024x600 @ 1bpp, MSB = leftmost pixel, 1 = foreground
+    SM_ATTR   = 0x84,   // 1bpp bitmap + colour attribute per block (rgb_display_set_attr_mode)
+    SM_16C_512  = 0x85, // 512x300 @ 4bpp, shown at 2x; colours are VGA palette entries 0-15
+    SM_16C_1024 = 0x86, // 1024x600 @ 4bpp (300 KB, PSRAM); high nibble = left pixel
+    SM_RGB565 = 0x87,   // 256x150 @ 16bpp direct colour (RGB565), 4x
+    SM_RGB565_FULL = 0x88, // 1024x600 @ 16bpp direct colour (1.2 MB, PSRAM), copied 1:1;
+                           // set_mode fails if PSRAM can't copy a band within budget
+    SM_MODEX  = 0x89,   // Unchained VGA 320x240 @ 8bpp, four planes (rgb_display_modex_*)
 } screen_mode_t;
 
 // Callbacks for integrating with an external terminal / console system.
@@ -64,11 +76,142 @@ int rgb_display_set_mode(screen_mode_t mode);  // Returns 0 on success
 uint8_t *rgb_display_get_framebuffer(void);    // Returns NULL in text mode
 int rgb_display_get_fb_width(void);            // Returns current framebuffer width (0 in text mode)
 int rgb_display_get_fb_height(void);           // Returns current framebuffer height (0 in text mode)
+int rgb_display_get_fb_stride(void);           // Bytes per framebuffer row
+int rgb_display_get_fb_bpp(void);              // Bits per pixel: 8, 16 (SM_RGB565*), 4 (SM_16C_*), 2 (SM_CGA4), 1 (SM_MONO, SM_ATTR)
+int rgb_display_get_fb_bank(void);             // Odd rows start this many bytes in (SM_CGA4: 0x2000), else 0
+
+// SM_CGA4 colours: palette 0 (green/red/brown) or 1 (cyan/magenta/white), bright
+// or not, and background (pixel value 0) from the 16 CGA colours. Default 1, bright, black.
+void rgb_display_set_cga_palette(int palette, bool intensity, int background);
+
+// SM_MONO foreground and background (RGB565); white on black by default
+void rgb_display_set_mono_colors(uint16_t fg, uint16_t bg);
+
+// Scan out straight from an application-owned 8bpp buffer (rows may be padded:
+// stride >= width), scaled by an integer factor (0 = fit the panel, any ratio)
+// and centred. Enters SM_EXTERNAL;
+// the driver allocates no framebuffer. Calling again with the same geometry
+// swaps buffers at the next vsync. The buffer must stay valid until the mode changes.
+int rgb_display_set_external_framebuffer(uint8_t *pixels, int width, int height, int stride, int scale);
+
+// Bitmap + attribute mode (ZX Spectrum style): a 1bpp bitmap, 512x300 shown at
+// 2x or 1024x600 native, plus one text-style attribute byte, (bg << 4) | fg in
+// the text palette, per 8x8 or 8x16 block. Bit 1 = fg. Scanned out at text speed.
+int rgb_display_set_attr_mode(int width, int block_height);  // width 512 or 1024; block 8 or 16
+uint8_t *rgb_display_get_attributes(int *cols, int *rows);   // Draw page's attributes, row-major
+
+// Mode X (SM_MODEX): 256 KB of VGA memory as four 64 KB planes; plane p holds
+// the pixels with x % 4 == p, and byte offset y * 80 + x / 4 addresses four
+// pixels. The planes are stored interleaved (offset o, plane p at framebuffer
+// byte 4 * o + p), so the framebuffer is also a linear 320-wide 8bpp surface
+// of 819 rows for the rgb_gfx primitives. Offsets are plane bytes (0..65535).
+// The display scans linearly from the start address, wrapping at 64 KB as on
+// VGA; the viewport and transitions do not apply.
+void rgb_display_modex_set_map_mask(uint8_t mask);  // Planes written (bits 0-3); 0x0F on mode set
+void rgb_display_modex_set_read_map(int plane);     // Plane read by rgb_display_modex_read
+void rgb_display_modex_write(int offset, uint8_t value);
+void rgb_display_modex_fill(int offset, uint8_t value, int count);  // count bytes, 4 pixels each
+uint8_t rgb_display_modex_read(int offset);         // Also loads the latches
+void rgb_display_modex_latch_copy(int dst_offset, int src_offset, int count);  // Write mode 1, masked
+void rgb_display_modex_set_start(int offset);       // Start address (any offset), latched at the next vsync
+
+// Graphics mode at any resolution up to the panel size (e.g. 320x240, 400x240),
+// scaled to fill the panel, or the largest square-pixel fit when keep_aspect.
+int rgb_display_set_custom_mode(int width, int height, bool keep_aspect);
+
+// Virtual framebuffer: a drawing surface larger than the visible mode (e.g.
+// 512x300 behind a 256x150 view). The getters above then report the virtual
+// size. 8bpp and single-buffered only; drops the z-buffer. 0 restores the mode size.
+int rgb_display_set_virtual_size(int width, int height);  // Returns 0 on success
+void rgb_display_get_view_size(int *width, int *height);  // Visible part
+
+// Viewport: top-left of the visible part, applied by the scaler at the next
+// vsync. Clamped to the virtual edges unless wrap-around is enabled.
+void rgb_display_set_viewport(int x, int y);
+void rgb_display_get_viewport(int *x, int *y);
+void rgb_display_set_viewport_wrap(bool wrap);
+
+// EPX edge-aware upscaling (Scale2x/Scale3x, Scale2x doubled for 4x) instead of
+// pixel replication. Integer 2x-4x scales only; returns -1 otherwise. Turned off
+// by mode changes, and automatically when bands keep exceeding their time budget.
+int rgb_display_set_smoothing(bool enable);
+
+typedef struct {
+    uint32_t band_budget_cycles;  // CPU cycles a bounce band may take
+    uint32_t band_cycles_max;     // Slowest band of the last frame
+    uint32_t band_cycles_avg;     // Average band of the last frame
+    uint32_t overrun_frames;      // Frames with a band over budget
+    bool smoothing;               // EPX currently active
+    bool fell_back;               // EPX was switched off for exceeding the budget
+} rgb_display_scaler_stats_t;
+
+void rgb_display_get_scaler_stats(rgb_display_scaler_stats_t *stats);
+
+// CRT effect: scan-out through a copy of the palette dimmed to brightness/256
+// (0..256) for chosen LCD lines and sub-columns of every scaled pixel. Bit k of
+// line_mask / column_mask selects the k-th line / column within each pixel,
+// e.g. (0x04, 0, 160) for scanlines at 3x, (0x08, 0x08, 160) for a grid at 4x.
+// Column patterns need an integer scale. Both masks 0 turn the effect off.
+void rgb_display_set_crt_effect(uint8_t line_mask, uint8_t column_mask, int brightness);
+
+// Optional 16-bit depth buffer, same size as the framebuffer (graphics modes only).
+// Freed together with the framebuffer when leaving graphics mode.
+int rgb_display_set_zbuffer(bool enable);      // Returns 0 on success
+uint16_t *rgb_display_get_zbuffer(void);       // Returns NULL if not enabled
+
+// Dirty-tile tracking (graphics modes): every rgb_gfx_* primitive marks the
+// tiles it touches. Tile (tx, ty) is bit (tx & 31) of word
+// [ty * words_per_row + (tx >> 5)]. Consumers read, then clear.
+#define RGB_DISPLAY_TILE_SHIFT 4
+#define RGB_DISPLAY_TILE_SIZE  (1 << RGB_DISPLAY_TILE_SHIFT)  // 16x16 pixels
+void rgb_display_mark_dirty(int x, int y, int w, int h);  // After raw framebuffer writes
+const uint32_t *rgb_display_get_dirty_tiles(int *cols, int *rows, int *words_per_row);  // NULL in text mode
+void rgb_display_clear_dirty(void);
+
+// Page flipping (graphics modes only; freed with the framebuffer). While
+// double-buffered, rgb_display_get_framebuffer() returns the hidden page and
+// rgb_display_flip() shows it at the next vsync, then prepares the other page:
+typedef enum {
+    RGB_DISPLAY_FLIP_NONE = 0,    // Single buffer (default)
+    RGB_DISPLAY_FLIP_SWAP,        // No copy: the app redraws every frame in full
+    RGB_DISPLAY_FLIP_COPY_ALL,    // Copy the whole frame forward
+    RGB_DISPLAY_FLIP_COPY_DIRTY,  // Copy only the tiles dirtied since the last flip
+} rgb_display_flip_mode_t;
+
+typedef struct {
+    uint16_t tile_size;      // Tile edge in pixels
+    uint32_t copy_bytes;     // Bytes copied forward by the last flip
+    uint32_t dirty_tiles;    // Tiles copied by the last flip
+    uint32_t total_tiles;
+    uint32_t flips;
+} rgb_display_flip_stats_t;
+
+// rgb_display_flip(), and going back to RGB_DISPLAY_FLIP_NONE, return -1 without
+// swapping pages if no vsync comes within ~2 frames; the call can be repeated.
+int rgb_display_set_double_buffer(rgb_display_flip_mode_t mode);  // Returns 0 on success
+int rgb_display_flip(void);              // Also clears the dirty-tile map
+void rgb_display_get_flip_stats(rgb_display_flip_stats_t *stats);
+
+// Transitions (graphics modes): over `frames` vsyncs the scaler reveals the
+// current image in place of `from`, span by span, at no cost to the caller.
+// `from` has the framebuffer's size and stride and must stay untouched until
+// rgb_display_transition_busy() returns false. 8bpp modes; smoothing pauses meanwhile.
+typedef enum {
+    RGB_DISPLAY_TRANSITION_DISSOLVE = 0,  // Random 4-column spans
+    RGB_DISPLAY_TRANSITION_WIPE,          // Left to right
+    RGB_DISPLAY_TRANSITION_BLINDS,        // Horizontal slats, top to bottom
+} rgb_display_transition_t;
+
+#define RGB_DISPLAY_BLINDS_SLATS 8
+
+int rgb_display_start_transition(const uint8_t *from, rgb_display_transition_t type, int frames);  // Returns 0 on success
+bool rgb_display_transition_busy(void);
 
 // VGA 256-color palette (only used in graphics modes)
 void rgb_display_set_vga_palette(const uint16_t palette[256]);
 void rgb_display_set_vga_palette_entry(int index, uint16_t rgb565);
 uint16_t rgb_display_get_vga_palette_entry(int index);
+const uint16_t *rgb_display_get_vga_palette(void);  // All 256 entries (read-only)
 
 // VSYNC synchronization (only used in graphics modes)
 // Block until next vertical blank
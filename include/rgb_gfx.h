@@ -3,12 +3,95 @@
  *
  * Provides basic drawing functions for use in graphics mode (SM_VGA13H, SM_150P).
  * All functions operate on the current framebuffer obtained via rgb_display_get_framebuffer().
+ * In packed modes (1bpp SM_MONO/SM_ATTR, 2bpp SM_CGA4, 4bpp SM_16C_*) colours are
+ * the low 1, 2 or 4 bits and spans are filled a byte at a time. Fills, lines,
+ * ellipses, polygons, blits, flood and pattern fills work at any depth (and
+ * follow the CGA row interleave); blending, remapping, scaled/rotated blits,
+ * textures and gradients draw 8bpp framebuffers only.
  */
 
 #pragma once
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+
+// Maximum number of vertices accepted by rgb_gfx_polyfill()
+#define RGB_GFX_POLY_MAX_POINTS 64
+
+typedef struct {
+    int16_t x, y;
+} rgb_gfx_point_t;
+
+// 8bpp texture with power-of-two dimensions; texture coordinates wrap
+typedef struct {
+    const uint8_t *pixels;   // (1 << w_log2) x (1 << h_log2) texels, row-major
+    uint8_t w_log2, h_log2;
+    int16_t transparent;     // Texel index to skip, or -1 for opaque
+} rgb_gfx_texture_t;
+
+// Bytes per pending span in a flood-fill arena (see rgb_gfx_set_fill_arena)
+#define RGB_GFX_FILL_SEGMENT_SIZE 8
+
+// Blend operations for rgb_gfx_build_blend_table()
+typedef enum {
+    RGB_GFX_BLEND_HALF,      // 50% translucency: (src + dst) / 2
+    RGB_GFX_BLEND_ADD,       // Additive, saturating
+    RGB_GFX_BLEND_MULTIPLY,  // src * dst
+} rgb_gfx_blend_t;
+
+// Blend table: 256x256 palette indices, indexed [(src << 8) | dst]
+#define RGB_GFX_BLEND_TABLE_SIZE (256 * 256)
+
+// Software sprite for rgb_gfx_sprites_update()
+typedef struct {
+    // Set by the application
+    const uint8_t *data;     // 8bpp pixels
+    int16_t w, h, stride;
+    int16_t x, y;            // Position (may be partly or fully off screen)
+    int16_t z;               // Draw order: higher z is drawn on top
+    int16_t transparent;     // Transparent colour index, or -1
+    bool visible;
+    bool flip_x, flip_y;
+    bool dirty;              // Set after changing pixels or size in place; cleared on redraw
+    uint8_t *save;           // Save-under buffer, at least w * h bytes
+
+    // Managed by the sprite manager
+    struct {
+        bool drawn;
+        int16_t x, y, w, h;      // Saved (clipped) rectangle
+        const uint8_t *data;
+        int16_t src_x, src_y, z; // Position, z and flips at the last draw
+        bool flip_x, flip_y;
+        uint32_t seq;            // Draw sequence number, for restore ordering
+    } drawn;
+} rgb_gfx_sprite_t;
+
+// Per-frame sprite manager statistics
+typedef struct {
+    uint32_t dirty_pixels;   // Area of the merged dirty rectangles
+    uint16_t dirty_rects;    // Number of merged dirty rectangles
+    uint16_t sprites_drawn;  // Sprites redrawn
+} rgb_gfx_sprite_stats_t;
+
+// Maximum sprites per rgb_gfx_sprites_update() call
+#define RGB_GFX_MAX_SPRITES 64
+
+// Collision mask: one opacity bit per pixel, bit 63 of each row is the leftmost
+// column. rows holds 2 * h words: the rows as drawn, then mirrored for flip_x.
+typedef struct {
+    uint64_t *rows;
+    int16_t w, h;            // w <= RGB_GFX_MASK_MAX_W
+} rgb_gfx_mask_t;
+
+#define RGB_GFX_MASK_MAX_W 64
+
+// Vertex for rgb_gfx_textri()
+typedef struct {
+    int16_t x, y;    // Screen position
+    uint16_t z;      // Depth, smaller is nearer (only used with the z-buffer)
+    int32_t u, v;    // Texture coordinates in texels, 16.16 fixed point
+} rgb_gfx_vertex_t;
 
 // Clear entire framebuffer to a single color
 void rgb_gfx_clear(uint8_t color);
@@ -28,6 +111,18 @@ void rgb_gfx_rect(int x, int y, int w, int h, uint8_t color);
 // Filled rectangle
 void rgb_gfx_rectfill(int x, int y, int w, int h, uint8_t color);
 
+// Direct colour (RGB565) for 16bpp framebuffers (SM_RGB565, SM_RGB565_FULL);
+// no-ops at other depths. The 8-bit primitives draw there too, through the VGA
+// palette, except flood fills and rgb_gfx_read_rect, which need indexed pixels.
+void rgb_gfx_clear16(uint16_t color);
+void rgb_gfx_pixel16(int x, int y, uint16_t color);
+void rgb_gfx_hline16(int x, int y, int w, uint16_t color);
+void rgb_gfx_vline16(int x, int y, int h, uint16_t color);
+void rgb_gfx_rectfill16(int x, int y, int w, int h, uint16_t color);
+// src_stride in pixels; transparent_color: RGB565 value to skip, or -1
+void rgb_gfx_blit16(const uint16_t *data, int x, int y, int w, int h,
+                    int src_stride, int32_t transparent_color);
+
 // Blit 8bpp sprite data with transparency
 // data: source pixel data (row-major, 8bpp indexed)
 // x, y: destination position
@@ -41,3 +136,130 @@ void rgb_gfx_blit(const uint8_t *data, int x, int y, int w, int h,
 void rgb_gfx_blit_flip(const uint8_t *data, int x, int y, int w, int h,
                       int src_stride, int transparent_color,
                       bool flip_x, bool flip_y);
+
+// Copy a framebuffer rectangle out to dst (the reverse of an opaque blit).
+// Parts outside the framebuffer are left untouched in dst.
+void rgb_gfx_read_rect(int x, int y, int w, int h, uint8_t *dst, int dst_stride);
+
+// Filled triangle (scanline rasterised, 16.16 fixed-point edges)
+void rgb_gfx_trifill(int x0, int y0, int x1, int y1, int x2, int y2, uint8_t color);
+
+// Filled polygon, convex or concave (even-odd rule)
+// pts: vertices in order (the polygon is closed implicitly), n: 3..RGB_GFX_POLY_MAX_POINTS
+void rgb_gfx_polyfill(const rgb_gfx_point_t *pts, int n, uint8_t color);
+
+// Line (Bresenham with horizontal runs, clipped analytically)
+void rgb_gfx_line(int x0, int y0, int x1, int y1, uint8_t color);
+
+// Line of the given thickness in pixels (at most 16384), with square (butt) ends
+void rgb_gfx_line_thick(int x0, int y0, int x1, int y1, int thickness, uint8_t color);
+
+// Triangle and polygon outlines
+void rgb_gfx_triangle(int x0, int y0, int x1, int y1, int x2, int y2, uint8_t color);
+void rgb_gfx_polygon(const rgb_gfx_point_t *pts, int n, uint8_t color);
+
+// Circles and ellipses (midpoint algorithm), outline and filled
+void rgb_gfx_circle(int cx, int cy, int r, uint8_t color);
+void rgb_gfx_circlefill(int cx, int cy, int r, uint8_t color);
+void rgb_gfx_ellipse(int cx, int cy, int rx, int ry, uint8_t color);
+void rgb_gfx_ellipsefill(int cx, int cy, int rx, int ry, uint8_t color);
+
+// Circular arc outline and filled pie slice
+// Angles in degrees, counter-clockwise from 3 o'clock; drawn from start_deg to end_deg
+void rgb_gfx_arc(int cx, int cy, int r, int start_deg, int end_deg, uint8_t color);
+void rgb_gfx_piefill(int cx, int cy, int r, int start_deg, int end_deg, uint8_t color);
+
+// Clear the z-buffer (see rgb_display_set_zbuffer) to the given depth, usually 0xFFFF
+void rgb_gfx_zclear(uint16_t z);
+
+// Affine texture-mapped triangle
+// use_zbuffer: depth-test and write against the z-buffer, if one is allocated
+void rgb_gfx_textri(const rgb_gfx_vertex_t *v0, const rgb_gfx_vertex_t *v1,
+                    const rgb_gfx_vertex_t *v2, const rgb_gfx_texture_t *tex, bool use_zbuffer);
+
+// Build a blend table for the current VGA palette into a caller-provided
+// RGB_GFX_BLEND_TABLE_SIZE buffer. Rebuild after changing the palette.
+void rgb_gfx_build_blend_table(uint8_t *table, rgb_gfx_blend_t mode);
+
+// Allocate and build a blend table. Internal RAM is used unless prefer_psram
+// is set (or internal RAM is short). Returns NULL on allocation failure.
+uint8_t *rgb_gfx_create_blend_table(rgb_gfx_blend_t mode, bool prefer_psram);
+void rgb_gfx_free_blend_table(uint8_t *table);
+
+// Blit blended onto the framebuffer through a blend table
+void rgb_gfx_blit_blend(const uint8_t *data, int x, int y, int w, int h,
+                        int src_stride, int transparent_color, const uint8_t *table);
+
+// Blend a solid colour over a rectangle through a blend table
+void rgb_gfx_rectfill_blend(int x, int y, int w, int h, uint8_t color, const uint8_t *table);
+
+// Build `levels` light-level colormaps (levels * 256 bytes) for the current VGA palette.
+// Map 0 is the identity (full brightness), the last map fades to black.
+void rgb_gfx_build_colormaps(uint8_t *maps, int levels);
+
+// Blit with each source pixel passed through a 256-entry remap table
+// (lighting levels, damage flashes, team colours). Transparency uses the source index.
+void rgb_gfx_blit_remap(const uint8_t *data, int x, int y, int w, int h,
+                        int src_stride, int transparent_color, const uint8_t *remap);
+
+// Pass the framebuffer pixels inside a rectangle through a 256-entry remap table
+void rgb_gfx_rectfill_remap(int x, int y, int w, int h, const uint8_t *remap);
+
+// Blit scaled by 16.16 fixed-point factors (0x10000 = 1:1), top-left at (x, y)
+void rgb_gfx_blit_scaled(const uint8_t *data, int x, int y, int w, int h,
+                         int src_stride, int transparent_color,
+                         int32_t scale_x, int32_t scale_y);
+
+// Blit rotated and scaled about a pivot
+// pivot_x, pivot_y: point in the sprite that lands on (x, y)
+// angle_deg: counter-clockwise rotation, scale: 16.16 fixed point
+void rgb_gfx_blit_rotated(const uint8_t *data, int w, int h, int src_stride,
+                          int transparent_color, int pivot_x, int pivot_y,
+                          int x, int y, int angle_deg, int32_t scale);
+
+// Set the work arena for flood fills (the span stack; no recursion or heap use).
+// Pass NULL to revert to the built-in 1 KB arena. Complex shapes need more:
+// roughly one segment per concurrently open span.
+void rgb_gfx_set_fill_arena(void *buf, size_t size);
+
+// Scanline flood fill of the 4-connected region of the seed pixel's colour.
+// Returns 0 when complete, -1 if the arena overflowed (fill incomplete).
+// At 1, 2 and 4bpp only the low bits of the colours count (0..(1 << bpp) - 1).
+int rgb_gfx_floodfill(int x, int y, uint8_t color);
+
+// Fill the 4-connected region bounded by the border colour. Same return value.
+int rgb_gfx_borderfill(int x, int y, uint8_t border, uint8_t color);
+
+// Rectangle filled with an 8x8 pattern: bit 7 of pattern[row] is the leftmost pixel,
+// set bits take fg and clear bits bg. Anchored to screen coordinates.
+void rgb_gfx_rectfill_pattern(int x, int y, int w, int h, const uint8_t pattern[8],
+                              uint8_t fg, uint8_t bg);
+
+// Rectangle filled with a gradient across the palette ramp c0..c1 (consecutive indices,
+// e.g. the 232-255 grays), ordered-dithered with an 8x8 Bayer matrix
+void rgb_gfx_rectfill_gradient(int x, int y, int w, int h, uint8_t c0, uint8_t c1, bool vertical);
+
+// Software sprites with save-under. Call once per frame (after vsync) with the
+// same array: sprites that moved or changed, and any sprites overlapping them,
+// get their backgrounds restored and are redrawn in z order. Everything else is
+// left alone. stats may be NULL. Indexed and packed framebuffers only: both
+// calls do nothing at 16bpp, where the save-under could not hold the pixels.
+void rgb_gfx_sprites_update(rgb_gfx_sprite_t *sprites, int count, rgb_gfx_sprite_stats_t *stats);
+
+// Restore the background under all drawn sprites (e.g. before redrawing the
+// background). The next update draws them again.
+void rgb_gfx_sprites_erase(rgb_gfx_sprite_t *sprites, int count);
+
+// Build a collision mask from 8bpp sprite pixels (non-transparent = solid).
+// rows must hold 2 * h words. Returns 0, or -1 if w is too wide.
+int rgb_gfx_mask_build(rgb_gfx_mask_t *mask, uint64_t *rows, const uint8_t *data,
+                       int w, int h, int stride, int transparent);
+
+// Pixel-perfect overlap test of two masks at screen positions. Returns the
+// first (topmost) contact row relative to ay, or -1 if they don't touch.
+int rgb_gfx_collide(const rgb_gfx_mask_t *a, int ax, int ay,
+                    const rgb_gfx_mask_t *b, int bx, int by);
+
+// As rgb_gfx_collide, for sprites drawn with rgb_gfx_blit_flip
+int rgb_gfx_collide_flip(const rgb_gfx_mask_t *a, int ax, int ay, bool a_flip_x, bool a_flip_y,
+                         const rgb_gfx_mask_t *b, int bx, int by, bool b_flip_x, bool b_flip_y);
@@ -8,20 +8,44 @@
 
 #include "rgb_display.h"
 #include "rgb_gfx.h"
+#include "rgb_display_priv.h"
 #include "esp_log.h"
 #include "esp_lcd_panel_ops.h"
 #include "esp_lcd_panel_rgb.h"
 #include "esp_heap_caps.h"
 #include "esp_memory_utils.h"
+#include "esp_cpu.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
 #include <string.h>
+#if CONFIG_IDF_TARGET_ESP32S3
+#include "esp32s3/rom/cache.h"
+#endif
 
 static const char *TAG = "display";
 
 #define SCREEN_WIDTH    1024
 #define SCREEN_HEIGHT   600
 #define BOUNCE_HEIGHT_PX 12  // 12 lines = 24KB bounce buffer (used by both text and graphics modes)
+
+// Panel timing
+#define LCD_PCLK_HZ             (20 * 1000 * 1000)
+#define LCD_HSYNC_PULSE_WIDTH   162
+#define LCD_HSYNC_BACK_PORCH    152
+#define LCD_HSYNC_FRONT_PORCH   48
+#define LCD_LINE_PCLKS  (SCREEN_WIDTH + LCD_HSYNC_PULSE_WIDTH + LCD_HSYNC_BACK_PORCH + LCD_HSYNC_FRONT_PORCH)
+
+#ifdef CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ
+#define CPU_FREQ_MHZ    CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ
+#else
+#define CPU_FREQ_MHZ    240
+#endif
+
+// CPU cycles a bounce band may take: 3/4 of the time the panel needs to scan it
+// (12 lines at 1386 clocks / 20 MHz = 832 us, ~150k cycles at 240 MHz)
+#define BAND_BUDGET_CYCLES ((uint32_t)((uint64_t)BOUNCE_HEIGHT_PX * LCD_LINE_PCLKS * CPU_FREQ_MHZ * 3 / \
+                                       (4 * (LCD_PCLK_HZ / 1000000))))
+#define SMOOTH_FALLBACK_FRAMES 3  // Consecutive over-budget frames before smoothing is dropped
 #define FONT_WIDTH      8
 #define FONT_HEIGHT     16
 #define TEXT_COLS       128
@@ -31,8 +55,7 @@ static const char *TAG = "display";
 #define GFX_VGA_WIDTH   320
 #define GFX_VGA_HEIGHT  200
 #define GFX_VGA_SIZE    (GFX_VGA_WIDTH * GFX_VGA_HEIGHT)  // 64000 bytes
-#define GFX_VGA_SCALE   3      // 3x upscale: 320*3=960, 200*3=600
-#define GFX_VGA_MARGIN_X 32    // (1024 - 960) / 2 = 32 pixels black margin each side
+#define GFX_VGA_SCALE   3      // 3x upscale: 320*3=960, 200*3=600 (32 pixel margins)
 
 // Graphics mode constants - 150P (256x150)
 #define GFX_150P_WIDTH  256
@@ -40,11 +63,105 @@ static const char *TAG = "display";
 #define GFX_150P_SIZE   (GFX_150P_WIDTH * GFX_150P_HEIGHT)  // 38400 bytes
 #define GFX_150P_SCALE  4      // 4x upscale: 256*4=1024, 150*4=600 (perfect fit!)
 
-// Current mode dimensions (set during mode switch)
+// Monochrome mode: native panel resolution at 1bpp (75 KB)
+#define GFX_MONO_WIDTH  SCREEN_WIDTH
+#define GFX_MONO_HEIGHT SCREEN_HEIGHT
+
+// 16-colour modes at 4bpp: 512x300 at 2x (75 KB), 1024x600 native (300 KB)
+#define GFX_16C_WIDTH   (SCREEN_WIDTH / 2)
+#define GFX_16C_HEIGHT  (SCREEN_HEIGHT / 2)
+
+// Direct-colour mode: 256x150 RGB565 (75 KB), 4x like SM_150P
+#define GFX_RGB565_WIDTH  GFX_150P_WIDTH
+#define GFX_RGB565_HEIGHT GFX_150P_HEIGHT
+
+// Full-resolution direct colour: 1024x600 RGB565 (1.2 MB, PSRAM), copied
+// band by band. Lines are streamed through the cache, the next one preloaded
+// while the current one is copied.
+#define GFX_RGB565_FULL_WIDTH  SCREEN_WIDTH
+#define GFX_RGB565_FULL_HEIGHT SCREEN_HEIGHT
+
+// Mode X: unchained VGA, 320x240 pages in four 64 KB planes of 80-byte rows.
+// Planes are interleaved byte by byte (offset o, plane p at 4 * o + p), which
+// is linear 8bpp, so the scaler reads the planes with no conversion.
+#define GFX_MODEX_WIDTH       320
+#define GFX_MODEX_HEIGHT      240
+#define GFX_MODEX_ROW_BYTES   (GFX_MODEX_WIDTH / 4)
+#define GFX_MODEX_PLANE_BYTES 0x10000
+#define GFX_MODEX_BYTES       (4 * GFX_MODEX_PLANE_BYTES)  // 256 KB (PSRAM)
+#define GFX_MODEX_ROWS        (GFX_MODEX_PLANE_BYTES / GFX_MODEX_ROW_BYTES)  // 819 whole rows of VGA memory
+
+// CGA mode 04h: 320x200 at 2bpp, shown at 3x; even rows in the first 8 KB
+// bank, odd rows in the second, as in the B800h segment
+#define GFX_CGA_WIDTH   320
+#define GFX_CGA_HEIGHT  200
+#define GFX_CGA_BANK    0x2000
+
+// Framebuffers larger than this go to PSRAM first, leaving internal RAM to DMA
+#define FB_INTERNAL_MAX (128 * 1024)
+
+// Current mode dimensions (set during mode switch). The framebuffer may be a
+// virtual surface larger than the visible view.
 static int s_gfx_width = 0;
 static int s_gfx_height = 0;
-static int s_gfx_scale = 0;
+static int s_gfx_scale = 0;       // Integer scale, or 0 when scaled through s_xmap
 static int s_gfx_margin_x = 0;
+static int s_gfx_margin_y = 0;
+static int s_fb_stride = 0;       // Bytes per framebuffer row
+static int s_fb_bpp = 8;          // Bits per pixel: 8 indexed, 16 in SM_RGB565, 4 in SM_16C_*, 2 in SM_CGA4, 1 in SM_MONO / SM_ATTR
+static int s_fb_bank = 0;         // SM_CGA4: offset of the odd-row bank (0 = linear rows)
+static int s_attr_bytes = 0;      // SM_ATTR: attribute bytes stored after the bitmap
+static int s_attr_shift = 3;      // SM_ATTR: log2 of the attribute block height
+static bool s_fb_external = false; // Framebuffer owned by the application
+static int s_view_width = 0;
+static int s_view_height = 0;
+
+// Viewport into the framebuffer: requested, and latched at vsync for the scaler
+static volatile int s_view_x_req = 0, s_view_y_req = 0;
+static volatile int s_view_x = 0, s_view_y = 0;
+static bool s_view_wrap = false;
+
+// Scaler maps, built at mode set so the bounce callback does no arithmetic:
+// output pixels per view column (non-integer scales only), and the view row
+// for each LCD line (-1 = margin)
+static uint16_t s_xmap[SCREEN_WIDTH];  // Up to the panel width (e.g. 3 columns at 341-342)
+static int16_t s_ymap[SCREEN_HEIGHT];
+static uint8_t s_ysub[SCREEN_HEIGHT];  // Line index within its source row
+
+// EPX smoothing and per-band telemetry (cycles spent in the bounce callback)
+static volatile bool s_smooth = false;
+static uint32_t s_band_max = 0, s_band_sum = 0, s_band_count = 0;
+static int s_overrun_run = 0;
+static rgb_display_scaler_stats_t s_scaler_stats;
+
+// CRT effect: dimmed lines (by sub-row of each scaled pixel row) and sub-columns
+static volatile bool s_crt_on = false;
+static uint8_t s_crt_lines = 0;
+static uint8_t s_crt_columns = 0;
+static int s_crt_brightness = 256;
+static uint8_t s_line_dim[SCREEN_HEIGHT];
+
+// Transitions: the scaler takes each span of view columns from the old image
+// while its threshold is at or above the level, which on_vsync steps from 0 to
+// 256. Wipe and blinds add a column and a row pattern (mod 256); the dissolve
+// looks spans up in a 16x16 tile of all 256 thresholds, by span and row mod 16
+#define TRANS_SPAN_SHIFT 2  // 4 view columns per span
+static const uint8_t *volatile s_trans_from = NULL;
+static volatile int s_trans_level = 0;
+static int s_trans_frame = 0;
+static int s_trans_frames = 0;
+static uint8_t s_trans_col[SCREEN_WIDTH >> TRANS_SPAN_SHIFT];
+static uint8_t s_trans_row[SCREEN_HEIGHT];
+static uint8_t s_trans_tile[16][16];
+static bool s_trans_tiled = false;
+
+// Mode X map mask as byte lanes of a plane-interleaved word, read map, latches
+static uint32_t s_modex_mask = 0xFFFFFFFF;
+static int s_modex_read_map = 0;
+static uint32_t s_modex_latch = 0;
+static bool s_fb_modex = false;  // Framebuffer is the whole 256 KB, past the last whole row
+// Start address (plane offset of the top-left pixel): requested, and latched at vsync
+static volatile int s_modex_start_req = 0, s_modex_start = 0;
 
 // Pointer to external buffer (managed by caller, e.g. vterm)
 static lcd_cell_t *s_display_buffer = NULL;
@@ -53,7 +170,22 @@ static esp_lcd_panel_handle_t panel_handle = NULL;
 
 // Screen mode state
 static screen_mode_t s_screen_mode = SM_TEXT;
-static uint8_t *s_graphics_framebuffer = NULL;
+static uint8_t *s_graphics_framebuffer = NULL;  // Draw target (the back page when double-buffered)
+static uint16_t *s_zbuffer = NULL;
+
+// Page flipping: the scaler reads s_scan_fb; a pending flip is applied at vsync
+static uint8_t *volatile s_scan_fb = NULL;
+static uint8_t *volatile s_flip_pending = NULL;
+static portMUX_TYPE s_flip_lock = portMUX_INITIALIZER_UNLOCKED;  // Taking a pending flip
+static rgb_display_flip_mode_t s_flip_mode = RGB_DISPLAY_FLIP_NONE;
+static uint8_t *s_pages[2];  // Both pages while double-buffered
+static rgb_display_flip_stats_t s_flip_stats;
+
+// Dirty-tile map: one bit per tile, rows of s_dirty_words 32-bit words
+static uint32_t *s_dirty_tiles = NULL;
+static int s_dirty_cols = 0;
+static int s_dirty_rows = 0;
+static int s_dirty_words = 0;
 
 // VSYNC synchronization
 static SemaphoreHandle_t s_vsync_sem = NULL;
@@ -67,14 +199,32 @@ static uint32_t s_frame_count = 0;
 // LUTs
 static uint8_t font_ram[256][16];
 static uint32_t BYTE_MASKS[256][4];
+static uint32_t NIBBLE_MASKS_2X[16][4];  // Each bit of a nibble as a whole 2-pixel word
 static const uint32_t MASK_LUT[4] = { 0x00000000, 0xFFFF0000, 0x0000FFFF, 0xFFFFFFFF };
 
 // ATTR_LUT: precomputed bg32 and xor32 for each attribute byte
 // ATTR_LUT[attr][0] = bg32, ATTR_LUT[attr][1] = xor32
 static uint32_t ATTR_LUT[256][2];
 
-// VGA 256-color palette (RGB565)
+// SM_MONO colours, as ATTR_LUT pairs: bg32 and fg32 ^ bg32
+static uint32_t s_mono_bg32 = 0x00000000;
+static uint32_t s_mono_xor32 = 0xFFFFFFFF;
+
+// VGA 256-color palette (RGB565), and a dimmed copy for the CRT effect
 static uint16_t s_vga_palette[256];
+static uint16_t s_vga_palette_dim[256];
+
+// 4bpp scan-out from palette entries 0-15: a byte's two pixels as one word
+// (native), and each colour doubled into a word (2x)
+static uint32_t s_nibble_pair[256];
+static uint32_t s_nibble_2x[16];
+
+// SM_CGA4: each byte's four pixels tripled into six words, for the selected
+// CGA palette and background
+static uint32_t s_cga_quad[256][6];
+static int s_cga_palette = 1;
+static bool s_cga_intensity = true;
+static int s_cga_background = 0;
 
 // External font data
 extern const uint8_t terminus16_glyph_bitmap[];
@@ -102,6 +252,39 @@ static const uint16_t s_cga_colors[16] = {
     0xFFFF, // 15: White
 };
 
+// Rebuild the 4bpp tables after a change to palette entries 0-15
+static void rebuild_nibble_lut(void)
+{
+    for (int i = 0; i < 16; i++) {
+        s_nibble_2x[i] = ((uint32_t)s_vga_palette[i] << 16) | s_vga_palette[i];
+    }
+    for (int b = 0; b < 256; b++) {
+        s_nibble_pair[b] = ((uint32_t)s_vga_palette[b & 0x0F] << 16) | s_vga_palette[b >> 4];
+    }
+}
+
+// CGA palettes 0 (green/red/brown) and 1 (cyan/magenta/grey), low intensity
+static const uint8_t CGA_PALETTE_COLORS[2][3] = { { 2, 4, 6 }, { 3, 5, 7 } };
+
+static void rebuild_cga_lut(void)
+{
+    uint16_t colors[4];
+    colors[0] = s_cga_colors[s_cga_background & 0x0F];
+    for (int i = 0; i < 3; i++) {
+        colors[i + 1] = s_cga_colors[CGA_PALETTE_COLORS[s_cga_palette][i] + (s_cga_intensity ? 8 : 0)];
+    }
+    for (int b = 0; b < 256; b++) {
+        uint32_t c0 = colors[b >> 6], c1 = colors[(b >> 4) & 3];
+        uint32_t c2 = colors[(b >> 2) & 3], c3 = colors[b & 3];
+        s_cga_quad[b][0] = (c0 << 16) | c0;
+        s_cga_quad[b][1] = (c1 << 16) | c0;
+        s_cga_quad[b][2] = (c1 << 16) | c1;
+        s_cga_quad[b][3] = (c2 << 16) | c2;
+        s_cga_quad[b][4] = (c3 << 16) | c2;
+        s_cga_quad[b][5] = (c3 << 16) | c3;
+    }
+}
+
 static void init_vga_palette(void)
 {
     // Copy CGA colors to first 16 entries
@@ -128,6 +311,44 @@ static void init_vga_palette(void)
         uint16_t g6 = (gray * 63) / 255;
         s_vga_palette[232 + i] = (g5 << 11) | (g6 << 5) | g5;
     }
+    rebuild_nibble_lut();
+    rebuild_cga_lut();
+}
+
+static int allocate_framebuffer_pages(void);
+static void allocate_dirty_map(void);
+
+// Centre an out_w x out_h image of the view on the panel and build the scaler maps
+static void setup_scaler(int out_w, int out_h)
+{
+    s_gfx_margin_x = (SCREEN_WIDTH - out_w) / 2;
+    s_gfx_margin_y = (SCREEN_HEIGHT - out_h) / 2;
+
+    int sub = 0;
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        int v = y - s_gfx_margin_y;
+        s_ymap[y] = (v >= 0 && v < out_h) ? v * s_view_height / out_h : -1;
+        sub = (y > 0 && s_ymap[y] == s_ymap[y - 1]) ? sub + 1 : 0;
+        s_ysub[y] = sub;
+        s_line_dim[y] = sub < 8 && ((s_crt_lines >> sub) & 1);
+    }
+    s_smooth = false;
+    s_overrun_run = 0;
+    for (int x = 0; x < s_view_width; x++) {
+        s_xmap[x] = (x + 1) * out_w / s_view_width - x * out_w / s_view_width;
+    }
+}
+
+// Largest size with square pixels that fits the panel
+static void fit_to_panel(int w, int h, int *out_w, int *out_h)
+{
+    if (w * SCREEN_HEIGHT <= h * SCREEN_WIDTH) {
+        *out_h = SCREEN_HEIGHT;
+        *out_w = w * SCREEN_HEIGHT / h;
+    } else {
+        *out_w = SCREEN_WIDTH;
+        *out_h = h * SCREEN_WIDTH / w;
+    }
 }
 
 static int allocate_graphics_framebuffer(screen_mode_t mode)
@@ -137,27 +358,110 @@ static int allocate_graphics_framebuffer(screen_mode_t mode)
     }
 
     // Determine size based on mode
-    int fb_size;
     if (mode == SM_VGA13H) {
-        fb_size = GFX_VGA_SIZE;
         s_gfx_width = GFX_VGA_WIDTH;
         s_gfx_height = GFX_VGA_HEIGHT;
         s_gfx_scale = GFX_VGA_SCALE;
-        s_gfx_margin_x = GFX_VGA_MARGIN_X;
     } else if (mode == SM_150P) {
-        fb_size = GFX_150P_SIZE;
         s_gfx_width = GFX_150P_WIDTH;
         s_gfx_height = GFX_150P_HEIGHT;
+        s_gfx_scale = GFX_150P_SCALE;  // Perfect 4x fit, no margins
+    } else if (mode == SM_MONO) {
+        s_gfx_width = GFX_MONO_WIDTH;
+        s_gfx_height = GFX_MONO_HEIGHT;
+        s_gfx_scale = 1;
+        s_fb_bpp = 1;
+    } else if (mode == SM_16C_512) {
+        s_gfx_width = GFX_16C_WIDTH;
+        s_gfx_height = GFX_16C_HEIGHT;
+        s_gfx_scale = 2;
+        s_fb_bpp = 4;
+    } else if (mode == SM_RGB565) {
+        s_gfx_width = GFX_RGB565_WIDTH;
+        s_gfx_height = GFX_RGB565_HEIGHT;
         s_gfx_scale = GFX_150P_SCALE;
-        s_gfx_margin_x = 0;  // Perfect 4x fit, no margin needed
+        s_fb_bpp = 16;
+    } else if (mode == SM_RGB565_FULL) {
+        s_gfx_width = GFX_RGB565_FULL_WIDTH;
+        s_gfx_height = GFX_RGB565_FULL_HEIGHT;
+        s_gfx_scale = 1;
+        s_fb_bpp = 16;
+    } else if (mode == SM_CGA4) {
+        s_gfx_width = GFX_CGA_WIDTH;
+        s_gfx_height = GFX_CGA_HEIGHT;
+        s_gfx_scale = 3;
+        s_fb_bpp = 2;
+        s_fb_bank = GFX_CGA_BANK;
+    } else if (mode == SM_16C_1024) {
+        s_gfx_width = SCREEN_WIDTH;
+        s_gfx_height = SCREEN_HEIGHT;
+        s_gfx_scale = 1;
+        s_fb_bpp = 4;
+    } else if (mode == SM_MODEX) {
+        s_gfx_width = GFX_MODEX_WIDTH;
+        s_gfx_height = GFX_MODEX_HEIGHT;
+        s_gfx_scale = 0;  // 4:3 at 800x600, through the scaler maps
     } else {
         ESP_LOGE(TAG, "Unknown graphics mode for allocation: %d", mode);
         return -1;
     }
+    s_view_width = s_gfx_width;
+    s_view_height = s_gfx_height;
+    s_view_wrap = false;
+    if (s_gfx_scale) {
+        setup_scaler(s_gfx_width * s_gfx_scale, s_gfx_height * s_gfx_scale);
+    } else {
+        int out_w, out_h;
+        fit_to_panel(s_gfx_width, s_gfx_height, &out_w, &out_h);
+        setup_scaler(out_w, out_h);
+    }
 
-    // Try internal RAM first (faster for DMA)
-    s_graphics_framebuffer = heap_caps_malloc(fb_size,
-        MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    // Mode X: the view is one page of the whole 256 KB, scanned from the start address
+    if (mode == SM_MODEX) {
+        s_gfx_height = GFX_MODEX_ROWS;
+        s_fb_modex = true;
+        s_modex_start_req = s_modex_start = 0;
+        rgb_display_modex_set_map_mask(0x0F);
+        s_modex_read_map = 0;
+        s_modex_latch = 0;
+    }
+
+    return allocate_framebuffer_pages();
+}
+
+// Bytes per framebuffer page: pixel rows (or both CGA banks), then any SM_ATTR attributes
+static int framebuffer_bytes(void)
+{
+    if (s_fb_bank) return 2 * s_fb_bank;
+    if (s_fb_modex) return GFX_MODEX_BYTES;
+    return s_fb_stride * s_gfx_height + s_attr_bytes;
+}
+
+// Start of row y in a framebuffer page
+static inline uint8_t *page_row(uint8_t *page, int y)
+{
+    if (s_fb_bank) return page + (y & 1) * s_fb_bank + (y >> 1) * s_fb_stride;
+    return page + y * s_fb_stride;
+}
+
+// Framebuffer of s_gfx_width x s_gfx_height at s_fb_bpp, plus its dirty-tile map.
+// Not shown yet: the caller publishes s_scan_fb once the mode is complete.
+static int allocate_framebuffer_pages(void)
+{
+    s_fb_stride = (s_gfx_width * s_fb_bpp + 7) / 8;
+    int fb_size = framebuffer_bytes();
+    s_view_x = s_view_y = s_view_x_req = s_view_y_req = 0;
+
+    // Try internal RAM first (faster for DMA), unless the frame is large
+    s_graphics_framebuffer = NULL;
+#ifdef CONFIG_SPIRAM
+    if (fb_size > FB_INTERNAL_MAX) {
+        s_graphics_framebuffer = heap_caps_malloc(fb_size, MALLOC_CAP_SPIRAM);
+    }
+#endif
+    if (!s_graphics_framebuffer) {
+        s_graphics_framebuffer = heap_caps_malloc(fb_size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
 
 #ifdef CONFIG_SPIRAM
     if (!s_graphics_framebuffer) {
@@ -181,11 +485,54 @@ static int allocate_graphics_framebuffer(screen_mode_t mode)
 
     // Clear to black (palette index 0)
     memset(s_graphics_framebuffer, 0, fb_size);
+    s_fb_external = false;
+
+    allocate_dirty_map();
     return 0;
 }
 
+// Dirty-tile map (small, always internal); starts all dirty
+static void allocate_dirty_map(void)
+{
+    s_dirty_cols = (s_gfx_width + RGB_DISPLAY_TILE_SIZE - 1) >> RGB_DISPLAY_TILE_SHIFT;
+    s_dirty_rows = (s_gfx_height + RGB_DISPLAY_TILE_SIZE - 1) >> RGB_DISPLAY_TILE_SHIFT;
+    s_dirty_words = (s_dirty_cols + 31) >> 5;
+    s_dirty_tiles = heap_caps_malloc(s_dirty_rows * s_dirty_words * sizeof(uint32_t),
+        MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!s_dirty_tiles) {
+        ESP_LOGW(TAG, "No memory for dirty-tile map, tracking disabled");
+    }
+    rgb_display_clear_dirty();
+    rgb_display_mark_dirty(0, 0, s_gfx_width, s_gfx_height);
+}
+
 static void free_graphics_framebuffer(void)
 {
+    if (s_zbuffer) {
+        heap_caps_free(s_zbuffer);
+        s_zbuffer = NULL;
+    }
+    if (s_dirty_tiles) {
+        heap_caps_free(s_dirty_tiles);
+        s_dirty_tiles = NULL;
+    }
+    // Second page, if double-buffered (s_scan_fb may already be blanked)
+    if (s_flip_mode != RGB_DISPLAY_FLIP_NONE) {
+        heap_caps_free(s_pages[0] == s_graphics_framebuffer ? s_pages[1] : s_pages[0]);
+    }
+    s_trans_from = NULL;
+    s_scan_fb = NULL;
+    s_flip_pending = NULL;
+    s_flip_mode = RGB_DISPLAY_FLIP_NONE;
+    s_fb_bpp = 8;
+    s_fb_bank = 0;
+    s_attr_bytes = 0;
+    s_fb_modex = false;
+    if (s_fb_external) {
+        // Application-owned: just let go of it
+        s_graphics_framebuffer = NULL;
+        s_fb_external = false;
+    }
     if (s_graphics_framebuffer) {
         heap_caps_free(s_graphics_framebuffer);
         s_graphics_framebuffer = NULL;
@@ -226,13 +573,556 @@ static void precompute_tables(void)
         BYTE_MASKS[i][2] = MASK_LUT[(i >> 2) & 0x03];
         BYTE_MASKS[i][3] = MASK_LUT[i & 0x03];
     }
+    for (int i = 0; i < 16; i++) {
+        for (int b = 0; b < 4; b++) {
+            NIBBLE_MASKS_2X[i][b] = (i & (0x08 >> b)) ? 0xFFFFFFFF : 0;
+        }
+    }
+}
+
+// Expand n indexed pixels to RGB565, each repeated `scale` times
+FORCE_INLINE_ATTR uint16_t *scale_run(uint16_t *dest, const uint8_t *src, int n, int scale,
+                                      const uint16_t *pal)
+{
+    if (scale == 4) {
+        for (int x = 0; x < n; x++) {
+            uint16_t color = pal[src[x]];
+            *dest++ = color;
+            *dest++ = color;
+            *dest++ = color;
+            *dest++ = color;
+        }
+    } else if (scale == 3) {
+        for (int x = 0; x < n; x++) {
+            uint16_t color = pal[src[x]];
+            *dest++ = color;
+            *dest++ = color;
+            *dest++ = color;
+        }
+    } else if (scale == 2) {
+        for (int x = 0; x < n; x++) {
+            uint16_t color = pal[src[x]];
+            *dest++ = color;
+            *dest++ = color;
+        }
+    } else {
+        for (int x = 0; x < n; x++) {
+            uint16_t color = pal[src[x]];
+            for (int i = 0; i < scale; i++) *dest++ = color;
+        }
+    }
+    return dest;
+}
+
+// As scale_run, drawing the sub-columns set in col_mask from the dimmed palette
+FORCE_INLINE_ATTR uint16_t *scale_run_mask(uint16_t *dest, const uint8_t *src, int n, int scale,
+                                           const uint16_t *pal, const uint16_t *dim, uint8_t col_mask)
+{
+    bool m0 = col_mask & 1, m1 = col_mask & 2, m2 = col_mask & 4, m3 = col_mask & 8;
+    if (scale == 4) {
+        for (int x = 0; x < n; x++) {
+            uint16_t color = pal[src[x]], dark = dim[src[x]];
+            *dest++ = m0 ? dark : color;
+            *dest++ = m1 ? dark : color;
+            *dest++ = m2 ? dark : color;
+            *dest++ = m3 ? dark : color;
+        }
+    } else if (scale == 3) {
+        for (int x = 0; x < n; x++) {
+            uint16_t color = pal[src[x]], dark = dim[src[x]];
+            *dest++ = m0 ? dark : color;
+            *dest++ = m1 ? dark : color;
+            *dest++ = m2 ? dark : color;
+        }
+    } else {
+        for (int x = 0; x < n; x++) {
+            uint16_t color = pal[src[x]], dark = dim[src[x]];
+            for (int i = 0; i < scale; i++) *dest++ = ((col_mask >> i) & 1) ? dark : color;
+        }
+    }
+    return dest;
+}
+
+// Expand n indexed pixels to RGB565, pixel x repeated xmap[x] times
+FORCE_INLINE_ATTR uint16_t *map_run(uint16_t *dest, const uint8_t *src, const uint16_t *xmap, int n,
+                                    const uint16_t *pal)
+{
+    for (int x = 0; x < n; x++) {
+        uint16_t color = pal[src[x]];
+        int count = xmap[x];
+        switch (count) {
+        default: for (; count > 6; count--) *dest++ = color;  /* fall through */
+        case 6: *dest++ = color;  /* fall through */
+        case 5: *dest++ = color;  /* fall through */
+        case 4: *dest++ = color;  /* fall through */
+        case 3: *dest++ = color;  /* fall through */
+        case 2: *dest++ = color;  /* fall through */
+        case 1: *dest++ = color;  /* fall through */
+        case 0: break;
+        }
+    }
+    return dest;
+}
+
+// --- EPX smoothing ---
+//
+// Scale2x / Scale3x (AdvMAME) on palette indices: each output line needs only
+// its own sub-row of every pixel's block, from the rows above and below.
+// Neighbours are clamped at the framebuffer edges, or taken from the opposite
+// edge when the viewport wraps, as the scan does. 4x is Scale2x doubled.
+
+// One output line of Scale2x; half = 0 top, 1 bottom; rep = 1 (2x) or 2 (4x)
+static IRAM_ATTR uint16_t *epx2_line(uint16_t *dest, const uint8_t *up, const uint8_t *row,
+                                     const uint8_t *down, int x0, int n, int w, bool wrap,
+                                     int half, int rep, const uint16_t *pal)
+{
+    int left_edge = wrap ? w - 1 : 0, right_edge = wrap ? 0 : w - 1;  // Left of 0, right of w - 1
+    for (int x = x0; x < x0 + n; x++) {
+        uint8_t e = row[x];
+        uint8_t b = up[x], h = down[x];
+        uint8_t d = row[x > 0 ? x - 1 : left_edge], f = row[x < w - 1 ? x + 1 : right_edge];
+        uint8_t o0 = e, o1 = e;
+        if (b != h && d != f) {
+            if (half == 0) {
+                if (d == b) o0 = d;
+                if (b == f) o1 = f;
+            } else {
+                if (d == h) o0 = d;
+                if (h == f) o1 = f;
+            }
+        }
+        uint16_t c0 = pal[o0], c1 = pal[o1];
+        *dest++ = c0;
+        if (rep == 2) *dest++ = c0;
+        *dest++ = c1;
+        if (rep == 2) *dest++ = c1;
+    }
+    return dest;
+}
+
+// One output line (third = 0, 1, 2) of Scale3x
+static IRAM_ATTR uint16_t *epx3_line(uint16_t *dest, const uint8_t *up, const uint8_t *row,
+                                     const uint8_t *down, int x0, int n, int w, bool wrap,
+                                     int third, const uint16_t *pal)
+{
+    int left_edge = wrap ? w - 1 : 0, right_edge = wrap ? 0 : w - 1;
+    for (int x = x0; x < x0 + n; x++) {
+        int xl = x > 0 ? x - 1 : left_edge, xr = x < w - 1 ? x + 1 : right_edge;
+        uint8_t a = up[xl], b = up[x], c = up[xr];
+        uint8_t d = row[xl], e = row[x], f = row[xr];
+        uint8_t g = down[xl], h = down[x], i = down[xr];
+        uint8_t o0 = e, o1 = e, o2 = e;
+        if (b != h && d != f) {
+            if (third == 0) {
+                if (d == b) o0 = d;
+                if ((d == b && e != c) || (b == f && e != a)) o1 = b;
+                if (b == f) o2 = f;
+            } else if (third == 1) {
+                if ((d == b && e != g) || (d == h && e != a)) o0 = d;
+                if ((b == f && e != i) || (h == f && e != c)) o2 = f;
+            } else {
+                if (d == h) o0 = d;
+                if ((d == h && e != i) || (h == f && e != g)) o1 = h;
+                if (h == f) o2 = f;
+            }
+        }
+        *dest++ = pal[o0];
+        *dest++ = pal[o1];
+        *dest++ = pal[o2];
+    }
+    return dest;
+}
+
+static IRAM_ATTR uint16_t *epx_run(uint16_t *dest, const uint8_t *up, const uint8_t *row,
+                                   const uint8_t *down, int x0, int n, int w, bool wrap, int sub,
+                                   int scale, const uint16_t *pal)
+{
+    if (scale == 3) return epx3_line(dest, up, row, down, x0, n, w, wrap, sub, pal);
+    if (scale == 4) return epx2_line(dest, up, row, down, x0, n, w, wrap, sub >> 1, 2, pal);
+    return epx2_line(dest, up, row, down, x0, n, w, wrap, sub, 1, pal);
+}
+
+// Emit n view columns from fb column fb_x of one row, without smoothing
+FORCE_INLINE_ATTR uint16_t *emit_run(uint16_t *dest, const uint8_t *row, int fb_x, int vx, int n,
+                                     int scale, const uint16_t *pal, uint8_t crt_columns)
+{
+    if (scale && crt_columns) {
+        return scale_run_mask(dest, row + fb_x, n, scale, pal, s_vga_palette_dim, crt_columns);
+    }
+    if (scale) return scale_run(dest, row + fb_x, n, scale, pal);
+    return map_run(dest, row + fb_x, s_xmap + vx, n, pal);
+}
+
+// Emit view columns [vx, vx + n) of a transition row, each span from the old
+// or the new image depending on its threshold against the level. Span i's
+// threshold is col_threshold[i & span_mask] + row_threshold, mod 256.
+FORCE_INLINE_ATTR void transition_row(uint16_t *dest, const uint8_t *old_row, const uint8_t *new_row,
+                                      const uint8_t *col_threshold, int span_mask, int row_threshold,
+                                      int level, int view_x, int view_width,
+                                      int gfx_width, int scale, const uint16_t *pal, uint8_t crt_columns)
+{
+    int vx = 0;
+    while (vx < view_width) {
+        // Merge consecutive spans that read the same image
+        int span = vx >> TRANS_SPAN_SHIFT;
+        bool use_new = ((col_threshold[span & span_mask] + row_threshold) & 0xFF) < level;
+        int end = (span + 1) << TRANS_SPAN_SHIFT;
+        while (end < view_width &&
+               (((col_threshold[(end >> TRANS_SPAN_SHIFT) & span_mask] + row_threshold) & 0xFF) < level) == use_new) {
+            end += 1 << TRANS_SPAN_SHIFT;
+        }
+        if (end > view_width) end = view_width;
+
+        const uint8_t *row = use_new ? new_row : old_row;
+        int fb_x = view_x + vx;
+        if (fb_x >= gfx_width) fb_x -= gfx_width;
+        int n = end - vx;
+        int first = gfx_width - fb_x;
+        if (first > n) first = n;
+        dest = emit_run(dest, row, fb_x, vx, first, scale, pal, crt_columns);
+        if (first < n) dest = emit_run(dest, row, 0, vx + first, n - first, scale, pal, crt_columns);
+        vx = end;
+    }
+}
+
+// One band of an 8bpp indexed mode: scaled through the row and column maps,
+// with smoothing, CRT effect and transitions
+static IRAM_ATTR void render_indexed_band(void *buf, const uint8_t *scan_fb, int y_start, int num_lines)
+{
+    uint16_t *dest_base = (uint16_t *)buf;
+    int gfx_width = s_gfx_width;
+    int gfx_height = s_gfx_height;
+    int gfx_scale = s_gfx_scale;
+    int gfx_margin = s_gfx_margin_x;
+    int fb_stride = s_fb_stride;
+    int view_width = s_view_width;
+    int view_x = s_view_x;
+    int view_y = s_view_y;
+    bool smooth = s_smooth;
+    bool view_wrap = s_view_wrap;
+    bool crt = s_crt_on;
+    uint8_t crt_columns = crt ? s_crt_columns : 0;
+    const uint8_t *trans_from = s_trans_from;
+    int trans_level = s_trans_level;
+
+    // A wrapped viewport crossing the right edge shows two segments per row
+    int first_run = gfx_width - view_x;
+    if (first_run > view_width) first_run = view_width;
+
+    for (int line = 0; line < num_lines; line++) {
+        int lcd_y = y_start + line;
+
+        // Map LCD Y to source framebuffer Y through the row map
+        int src_y = s_ymap[lcd_y];
+        if (src_y < 0) continue;  // Top or bottom margin
+        src_y += view_y;
+        if (src_y >= gfx_height) src_y -= gfx_height;  // Wrapped viewport
+
+        uint16_t *dest = dest_base + (line * SCREEN_WIDTH);
+        const uint8_t *src_row = &scan_fb[src_y * fb_stride];
+
+        // Skip left margin (black from memset) - 0 for 150P, 32 for VGA13H
+        dest += gfx_margin;
+
+        // CRT scanlines: a dimmed palette copy for selected lines
+        const uint16_t *pal = (crt && s_line_dim[lcd_y]) ? s_vga_palette_dim : s_vga_palette;
+
+        if (trans_from) {
+            // Transition in progress (smoothing is suspended meanwhile)
+            int ty = s_ymap[lcd_y];
+            if (s_trans_tiled) {
+                transition_row(dest, &trans_from[src_y * fb_stride], src_row, s_trans_tile[ty & 15], 15, 0,
+                               trans_level, view_x, view_width, gfx_width, gfx_scale, pal, crt_columns);
+            } else {
+                transition_row(dest, &trans_from[src_y * fb_stride], src_row, s_trans_col, 0xFF, s_trans_row[ty],
+                               trans_level, view_x, view_width, gfx_width, gfx_scale, pal, crt_columns);
+            }
+        } else if (smooth) {
+            // Edge-aware upscale from this row and its neighbours, which wrap
+            // around the frame edges along with the viewport
+            const uint8_t *up = src_y > 0 ? src_row - fb_stride
+                              : view_wrap ? &scan_fb[(gfx_height - 1) * fb_stride] : src_row;
+            const uint8_t *down = src_y < gfx_height - 1 ? src_row + fb_stride
+                                : view_wrap ? scan_fb : src_row;
+            int sub = s_ysub[lcd_y];
+            dest = epx_run(dest, up, src_row, down, view_x, first_run, gfx_width, view_wrap, sub, gfx_scale, pal);
+            if (first_run < view_width) {
+                epx_run(dest, up, src_row, down, 0, view_width - first_run, gfx_width, view_wrap, sub,
+                        gfx_scale, pal);
+            }
+        } else if (gfx_scale && crt_columns) {
+            // Shadow-mask pattern within each scaled pixel
+            dest = scale_run_mask(dest, src_row + view_x, first_run, gfx_scale, pal,
+                                  s_vga_palette_dim, crt_columns);
+            if (first_run < view_width) {
+                scale_run_mask(dest, src_row, view_width - first_run, gfx_scale, pal,
+                               s_vga_palette_dim, crt_columns);
+            }
+        } else if (gfx_scale) {
+            // 4x for 150P (256*4=1024, perfect fit), 3x for VGA13H (320*3=960)
+            dest = scale_run(dest, src_row + view_x, first_run, gfx_scale, pal);
+            if (first_run < view_width) {
+                scale_run(dest, src_row, view_width - first_run, gfx_scale, pal);
+            }
+        } else {
+            // Non-integer ratio: run lengths from the column map
+            dest = map_run(dest, src_row + view_x, s_xmap, first_run, pal);
+            if (first_run < view_width) {
+                map_run(dest, src_row, s_xmap + first_run, view_width - first_run, pal);
+            }
+        }
+        // Right margin already black from memset
+    }
+}
+
+// One band of SM_MONO: 1:1, eight pixels per byte expanded through the glyph
+// masks of the text renderer, MSB first
+static IRAM_ATTR void render_mono_band(void *buf, const uint8_t *scan_fb, int y_start, int num_lines)
+{
+    uint32_t bg32 = s_mono_bg32;
+    uint32_t xor32 = s_mono_xor32;
+    int bytes = s_gfx_width >> 3;
+    int fb_stride = s_fb_stride;
+
+    for (int line = 0; line < num_lines; line++) {
+        int src_y = s_ymap[y_start + line];
+        if (src_y < 0) continue;
+        const uint8_t *src = &scan_fb[src_y * fb_stride];
+        uint32_t *dest = (uint32_t *)buf + line * (SCREEN_WIDTH / 2);
+
+        for (int i = 0; i < bytes; i++) {
+            uint8_t b = src[i];
+            if (b == 0) {
+                *dest++ = bg32; *dest++ = bg32; *dest++ = bg32; *dest++ = bg32;
+            } else {
+                const uint32_t *m = BYTE_MASKS[b];
+                *dest++ = (xor32 & m[0]) ^ bg32;
+                *dest++ = (xor32 & m[1]) ^ bg32;
+                *dest++ = (xor32 & m[2]) ^ bg32;
+                *dest++ = (xor32 & m[3]) ^ bg32;
+            }
+        }
+    }
+}
+
+// One band of SM_ATTR: bitmap bytes through the glyph masks, coloured by the
+// ATTR_LUT entry of their block, exactly as text cells. At 2x each bit is a
+// whole 32-bit word, and each bitmap row is shown on two lines.
+static IRAM_ATTR void render_attr_band(void *buf, const uint8_t *scan_fb, int y_start, int num_lines)
+{
+    int bytes = s_gfx_width >> 3;
+    int fb_stride = s_fb_stride;
+    int attr_shift = s_attr_shift;
+    const uint8_t *attrs = scan_fb + fb_stride * s_gfx_height;
+
+    for (int line = 0; line < num_lines; line++) {
+        int src_y = s_ymap[y_start + line];
+        if (src_y < 0) continue;
+        const uint8_t *src = &scan_fb[src_y * fb_stride];
+        const uint8_t *attr = &attrs[(src_y >> attr_shift) * bytes];
+        uint32_t *dest = (uint32_t *)buf + line * (SCREEN_WIDTH / 2);
+
+        if (s_gfx_scale == 1) {
+            for (int i = 0; i < bytes; i++) {
+                uint32_t bg32 = ATTR_LUT[attr[i]][0];
+                uint8_t b = src[i];
+                if (b == 0) {
+                    *dest++ = bg32; *dest++ = bg32; *dest++ = bg32; *dest++ = bg32;
+                } else {
+                    uint32_t xor32 = ATTR_LUT[attr[i]][1];
+                    const uint32_t *m = BYTE_MASKS[b];
+                    *dest++ = (xor32 & m[0]) ^ bg32;
+                    *dest++ = (xor32 & m[1]) ^ bg32;
+                    *dest++ = (xor32 & m[2]) ^ bg32;
+                    *dest++ = (xor32 & m[3]) ^ bg32;
+                }
+            }
+        } else {
+            for (int i = 0; i < bytes; i++) {
+                uint32_t bg32 = ATTR_LUT[attr[i]][0];
+                uint32_t xor32 = ATTR_LUT[attr[i]][1];
+                const uint32_t *hi = NIBBLE_MASKS_2X[src[i] >> 4];
+                const uint32_t *lo = NIBBLE_MASKS_2X[src[i] & 0x0F];
+                *dest++ = (xor32 & hi[0]) ^ bg32;
+                *dest++ = (xor32 & hi[1]) ^ bg32;
+                *dest++ = (xor32 & hi[2]) ^ bg32;
+                *dest++ = (xor32 & hi[3]) ^ bg32;
+                *dest++ = (xor32 & lo[0]) ^ bg32;
+                *dest++ = (xor32 & lo[1]) ^ bg32;
+                *dest++ = (xor32 & lo[2]) ^ bg32;
+                *dest++ = (xor32 & lo[3]) ^ bg32;
+            }
+        }
+    }
+}
+
+// One band of a 16-colour mode: two pixels per byte, high nibble first,
+// expanded through the byte-to-pixel-pair table (or doubled at 2x). A PSRAM
+// framebuffer has the next band's rows preloaded into cache meanwhile.
+static IRAM_ATTR void render_nibble_band(void *buf, const uint8_t *scan_fb, int y_start, int num_lines)
+{
+    int bytes = s_gfx_width >> 1;
+    int fb_stride = s_fb_stride;
+
+#if CONFIG_IDF_TARGET_ESP32S3
+    if (esp_ptr_external_ram(scan_fb) && y_start + num_lines < SCREEN_HEIGHT &&
+        Cache_DCache_Preload_Done()) {
+        int next_y = s_ymap[y_start + num_lines];
+        int last_y = s_ymap[SCREEN_HEIGHT - 1 < y_start + 2 * num_lines - 1 ?
+                            SCREEN_HEIGHT - 1 : y_start + 2 * num_lines - 1];
+        if (next_y >= 0 && last_y >= next_y) {
+            Cache_Start_DCache_Preload((uint32_t)&scan_fb[next_y * fb_stride],
+                                       (last_y - next_y + 1) * fb_stride, 0);
+        }
+    }
+#endif
+
+    for (int line = 0; line < num_lines; line++) {
+        int src_y = s_ymap[y_start + line];
+        if (src_y < 0) continue;
+        const uint8_t *src = &scan_fb[src_y * fb_stride];
+        uint32_t *dest = (uint32_t *)buf + line * (SCREEN_WIDTH / 2);
+
+        if (s_gfx_scale == 1) {
+            for (int i = 0; i < bytes; i += 4) {
+                *dest++ = s_nibble_pair[src[i]];
+                *dest++ = s_nibble_pair[src[i + 1]];
+                *dest++ = s_nibble_pair[src[i + 2]];
+                *dest++ = s_nibble_pair[src[i + 3]];
+            }
+        } else {
+            for (int i = 0; i < bytes; i++) {
+                uint8_t b = src[i];
+                *dest++ = s_nibble_2x[b >> 4];
+                *dest++ = s_nibble_2x[b & 0x0F];
+            }
+        }
+    }
+}
+
+// One band of SM_RGB565: no palette, each 32-bit load of two pixels becomes
+// four doubled words (4x)
+static IRAM_ATTR void render_rgb565_band(void *buf, const uint8_t *scan_fb, int y_start, int num_lines)
+{
+    int pairs = s_gfx_width >> 1;
+    int fb_stride = s_fb_stride;
+
+    for (int line = 0; line < num_lines; line++) {
+        int src_y = s_ymap[y_start + line];
+        if (src_y < 0) continue;
+        const uint32_t *src = (const uint32_t *)&scan_fb[src_y * fb_stride];
+        uint32_t *dest = (uint32_t *)buf + line * (SCREEN_WIDTH / 2);
+
+        for (int i = 0; i < pairs; i++) {
+            uint32_t p = src[i];
+            uint32_t left = (p << 16) | (p & 0xFFFF);
+            uint32_t right = (p >> 16) | (p & 0xFFFF0000);
+            dest[0] = left; dest[1] = left;
+            dest[2] = right; dest[3] = right;
+            dest += 4;
+        }
+    }
+}
+
+// One band of SM_RGB565_FULL: a straight copy, line by line, with the next
+// line preloaded into the cache while the current one is copied in 16-byte
+// groups.
+static IRAM_ATTR void copy_rgb565_band(void *buf, const uint8_t *scan_fb, int y_start, int num_lines)
+{
+    int fb_stride = s_fb_stride;
+
+    for (int line = 0; line < num_lines; line++) {
+        uint32_t *dest = (uint32_t *)buf + line * (SCREEN_WIDTH / 2);
+        int y = y_start + line;
+        const uint32_t *src = (const uint32_t *)&scan_fb[y * fb_stride];
+
+#if CONFIG_IDF_TARGET_ESP32S3
+        if (y + 1 < SCREEN_HEIGHT && esp_ptr_external_ram(scan_fb) &&
+            Cache_DCache_Preload_Done()) {
+            Cache_Start_DCache_Preload((uint32_t)&scan_fb[(y + 1) * fb_stride], fb_stride, 0);
+        }
+#endif
+
+        for (int i = 0; i < SCREEN_WIDTH / 2; i += 4) {
+            uint32_t a = src[i], b = src[i + 1], c = src[i + 2], d = src[i + 3];
+            dest[i] = a; dest[i + 1] = b; dest[i + 2] = c; dest[i + 3] = d;
+        }
+    }
+}
+
+// One band of SM_MODEX: each view row starts 320 bytes after the one above,
+// from the latched start address, and wraps at the end of the 256 KB as VGA
+// memory does, mid-row if need be. Like the 16-colour modes, a PSRAM
+// framebuffer has the next band's rows preloaded into cache meanwhile.
+static IRAM_ATTR void render_modex_band(void *buf, const uint8_t *scan_fb, int y_start, int num_lines)
+{
+    uint32_t base = (uint32_t)s_modex_start * 4;
+    bool crt = s_crt_on;
+
+#if CONFIG_IDF_TARGET_ESP32S3
+    if (esp_ptr_external_ram(scan_fb) && y_start + num_lines < SCREEN_HEIGHT &&
+        Cache_DCache_Preload_Done()) {
+        int next_y = s_ymap[y_start + num_lines];
+        int last_y = s_ymap[SCREEN_HEIGHT - 1 < y_start + 2 * num_lines - 1 ?
+                            SCREEN_HEIGHT - 1 : y_start + 2 * num_lines - 1];
+        if (next_y >= 0 && last_y >= next_y) {
+            uint32_t off = (base + next_y * GFX_MODEX_WIDTH) & (GFX_MODEX_BYTES - 1);
+            uint32_t len = (last_y - next_y + 1) * GFX_MODEX_WIDTH;
+            if (off + len > GFX_MODEX_BYTES) len = GFX_MODEX_BYTES - off;
+            Cache_Start_DCache_Preload((uint32_t)&scan_fb[off], len, 0);
+        }
+    }
+#endif
+
+    for (int line = 0; line < num_lines; line++) {
+        int lcd_y = y_start + line;
+        int src_y = s_ymap[lcd_y];
+        if (src_y < 0) continue;
+        uint32_t off = (base + src_y * GFX_MODEX_WIDTH) & (GFX_MODEX_BYTES - 1);
+        uint16_t *dest = (uint16_t *)buf + line * SCREEN_WIDTH + s_gfx_margin_x;
+        const uint16_t *pal = (crt && s_line_dim[lcd_y]) ? s_vga_palette_dim : s_vga_palette;
+
+        int first_run = GFX_MODEX_BYTES - off;
+        if (first_run > GFX_MODEX_WIDTH) first_run = GFX_MODEX_WIDTH;
+        dest = map_run(dest, scan_fb + off, s_xmap, first_run, pal);
+        if (first_run < GFX_MODEX_WIDTH) {
+            map_run(dest, scan_fb, s_xmap + first_run, GFX_MODEX_WIDTH - first_run, pal);
+        }
+    }
+}
+
+// One band of SM_CGA4: rows from the even or odd bank, each byte's four
+// pixels written as six precomputed words (3x)
+static IRAM_ATTR void render_cga_band(void *buf, const uint8_t *scan_fb, int y_start, int num_lines)
+{
+    int bytes = s_gfx_width >> 2;
+    int fb_stride = s_fb_stride;
+    int bank = s_fb_bank;
+
+    for (int line = 0; line < num_lines; line++) {
+        int src_y = s_ymap[y_start + line];
+        if (src_y < 0) continue;
+        const uint8_t *src = &scan_fb[(src_y & 1) * bank + (src_y >> 1) * fb_stride];
+        uint32_t *dest = (uint32_t *)buf + (line * SCREEN_WIDTH + s_gfx_margin_x) / 2;
+
+        for (int i = 0; i < bytes; i++) {
+            const uint32_t *q = s_cga_quad[src[i]];
+            dest[0] = q[0]; dest[1] = q[1]; dest[2] = q[2];
+            dest[3] = q[3]; dest[4] = q[4]; dest[5] = q[5];
+            dest += 6;
+        }
+    }
 }
 
 static IRAM_ATTR bool on_bounce_empty(esp_lcd_panel_handle_t panel, void *buf,
                                     int pos_px, int len_bytes, void *user_ctx)
 {
-    // Clear to black - also serves as fallback if nothing is ready
-    memset(buf, 0, len_bytes);
+    // Clear to black - also serves as fallback if nothing is ready. A
+    // full-resolution frame overwrites every pixel, so it skips the clear.
+    const uint8_t *scan_fb = s_scan_fb;
+    if (s_screen_mode != SM_RGB565_FULL || !scan_fb) {
+        memset(buf, 0, len_bytes);
+    }
 
     int y_start = pos_px / SCREEN_WIDTH;
     int num_lines = (len_bytes / 2) / SCREEN_WIDTH;
@@ -240,48 +1130,31 @@ static IRAM_ATTR bool on_bounce_empty(esp_lcd_panel_handle_t panel, void *buf,
     // Frame counter for cursor blink (increment at start of each frame)
     if (y_start == 0) s_frame_count++;
 
-    // === GRAPHICS MODE (SM_VGA13H or SM_150P) ===
-    if ((s_screen_mode == SM_VGA13H || s_screen_mode == SM_150P) && s_graphics_framebuffer) {
-        uint16_t *dest_base = (uint16_t *)buf;
-        int gfx_width = s_gfx_width;
-        int gfx_height = s_gfx_height;
-        int gfx_scale = s_gfx_scale;
-        int gfx_margin = s_gfx_margin_x;
-
-        for (int line = 0; line < num_lines; line++) {
-            int lcd_y = y_start + line;
-
-            // Map LCD Y to source framebuffer Y (divide by scale factor)
-            int src_y = lcd_y / gfx_scale;
-            if (src_y >= gfx_height) continue;  // Past end of framebuffer
-
-            uint16_t *dest = dest_base + (line * SCREEN_WIDTH);
-            const uint8_t *src_row = &s_graphics_framebuffer[src_y * gfx_width];
-
-            // Skip left margin (black from memset) - 0 for 150P, 32 for VGA13H
-            dest += gfx_margin;
-
-            // Render with appropriate horizontal scaling
-            if (gfx_scale == 4) {
-                // 4x scaling for 150P mode (256*4=1024, perfect fit)
-                for (int x = 0; x < gfx_width; x++) {
-                    uint16_t color = s_vga_palette[src_row[x]];
-                    *dest++ = color;
-                    *dest++ = color;
-                    *dest++ = color;
-                    *dest++ = color;
-                }
-            } else {
-                // 3x scaling for VGA13H mode (320*3=960)
-                for (int x = 0; x < gfx_width; x++) {
-                    uint16_t color = s_vga_palette[src_row[x]];
-                    *dest++ = color;
-                    *dest++ = color;
-                    *dest++ = color;
-                }
-            }
-            // Right margin already black from memset
+    // === GRAPHICS MODES ===
+    if (s_screen_mode != SM_TEXT && scan_fb) {
+        uint32_t t0 = esp_cpu_get_cycle_count();
+        if (s_screen_mode == SM_ATTR) {
+            render_attr_band(buf, scan_fb, y_start, num_lines);
+        } else if (s_fb_bpp == 1) {
+            render_mono_band(buf, scan_fb, y_start, num_lines);
+        } else if (s_fb_bpp == 4) {
+            render_nibble_band(buf, scan_fb, y_start, num_lines);
+        } else if (s_fb_bpp == 2) {
+            render_cga_band(buf, scan_fb, y_start, num_lines);
+        } else if (s_screen_mode == SM_RGB565_FULL) {
+            copy_rgb565_band(buf, scan_fb, y_start, num_lines);
+        } else if (s_fb_bpp == 16) {
+            render_rgb565_band(buf, scan_fb, y_start, num_lines);
+        } else if (s_screen_mode == SM_MODEX) {
+            render_modex_band(buf, scan_fb, y_start, num_lines);
+        } else {
+            render_indexed_band(buf, scan_fb, y_start, num_lines);
         }
+
+        uint32_t cycles = esp_cpu_get_cycle_count() - t0;
+        if (cycles > s_band_max) s_band_max = cycles;
+        s_band_sum += cycles;
+        s_band_count++;
         return false;
     }
 
@@ -377,6 +1250,40 @@ static IRAM_ATTR bool on_vsync(esp_lcd_panel_handle_t panel,
                                 void *user_ctx)
 {
     BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+    portENTER_CRITICAL_ISR(&s_flip_lock);
+    if (s_flip_pending) {
+        s_scan_fb = s_flip_pending;
+        s_flip_pending = NULL;
+    }
+    portEXIT_CRITICAL_ISR(&s_flip_lock);
+    s_view_x = s_view_x_req;
+    s_view_y = s_view_y_req;
+    s_modex_start = s_modex_start_req;
+
+    // Step a running transition; the last frame shows only the new image
+    if (s_trans_from) {
+        if (++s_trans_frame >= s_trans_frames) {
+            s_trans_from = NULL;
+        } else {
+            s_trans_level = (s_trans_frame * 256) / s_trans_frames;
+        }
+    }
+
+    // Publish band telemetry; drop smoothing if it keeps overrunning the budget
+    if (s_band_count) {
+        s_scaler_stats.band_cycles_max = s_band_max;
+        s_scaler_stats.band_cycles_avg = s_band_sum / s_band_count;
+        if (s_band_max > BAND_BUDGET_CYCLES) {
+            s_scaler_stats.overrun_frames++;
+            if (s_smooth && ++s_overrun_run >= SMOOTH_FALLBACK_FRAMES) {
+                s_smooth = false;
+                s_scaler_stats.fell_back = true;
+            }
+        } else {
+            s_overrun_run = 0;
+        }
+        s_band_max = s_band_sum = s_band_count = 0;
+    }
     if (s_waiting_for_vsync && s_vsync_sem) {
         xSemaphoreGiveFromISR(s_vsync_sem, &xHigherPriorityTaskWoken);
         s_waiting_for_vsync = false;
@@ -396,9 +1303,25 @@ void rgb_display_init(void)
         (void *)rgb_display_get_framebuffer,
         (void *)rgb_display_get_fb_width,
         (void *)rgb_display_get_fb_height,
+        (void *)rgb_display_get_fb_bpp,
+        (void *)rgb_display_set_mono_colors,
+        (void *)rgb_display_get_fb_bank,
+        (void *)rgb_display_set_cga_palette,
+        (void *)rgb_display_set_attr_mode,
+        (void *)rgb_display_get_attributes,
+        (void *)rgb_display_modex_set_map_mask,
+        (void *)rgb_display_modex_set_read_map,
+        (void *)rgb_display_modex_write,
+        (void *)rgb_display_modex_fill,
+        (void *)rgb_display_modex_read,
+        (void *)rgb_display_modex_latch_copy,
+        (void *)rgb_display_modex_set_start,
+        (void *)rgb_display_set_zbuffer,
+        (void *)rgb_display_get_zbuffer,
         (void *)rgb_display_set_vga_palette,
         (void *)rgb_display_set_vga_palette_entry,
         (void *)rgb_display_get_vga_palette_entry,
+        (void *)rgb_display_get_vga_palette,
         (void *)rgb_display_wait_vsync,
         // Graphics primitives
         (void *)rgb_gfx_clear,
@@ -407,8 +1330,68 @@ void rgb_display_init(void)
         (void *)rgb_gfx_vline,
         (void *)rgb_gfx_rect,
         (void *)rgb_gfx_rectfill,
+        (void *)rgb_gfx_clear16,
+        (void *)rgb_gfx_pixel16,
+        (void *)rgb_gfx_hline16,
+        (void *)rgb_gfx_vline16,
+        (void *)rgb_gfx_rectfill16,
+        (void *)rgb_gfx_blit16,
         (void *)rgb_gfx_blit,
         (void *)rgb_gfx_blit_flip,
+        (void *)rgb_gfx_trifill,
+        (void *)rgb_gfx_polyfill,
+        (void *)rgb_gfx_line,
+        (void *)rgb_gfx_line_thick,
+        (void *)rgb_gfx_triangle,
+        (void *)rgb_gfx_polygon,
+        (void *)rgb_gfx_circle,
+        (void *)rgb_gfx_circlefill,
+        (void *)rgb_gfx_ellipse,
+        (void *)rgb_gfx_ellipsefill,
+        (void *)rgb_gfx_arc,
+        (void *)rgb_gfx_piefill,
+        (void *)rgb_gfx_zclear,
+        (void *)rgb_gfx_textri,
+        (void *)rgb_gfx_build_blend_table,
+        (void *)rgb_gfx_create_blend_table,
+        (void *)rgb_gfx_free_blend_table,
+        (void *)rgb_gfx_blit_blend,
+        (void *)rgb_gfx_rectfill_blend,
+        (void *)rgb_gfx_build_colormaps,
+        (void *)rgb_gfx_blit_remap,
+        (void *)rgb_gfx_rectfill_remap,
+        (void *)rgb_gfx_blit_scaled,
+        (void *)rgb_gfx_blit_rotated,
+        (void *)rgb_gfx_set_fill_arena,
+        (void *)rgb_gfx_floodfill,
+        (void *)rgb_gfx_borderfill,
+        (void *)rgb_gfx_rectfill_pattern,
+        (void *)rgb_gfx_rectfill_gradient,
+        (void *)rgb_gfx_read_rect,
+        (void *)rgb_gfx_sprites_update,
+        (void *)rgb_gfx_sprites_erase,
+        (void *)rgb_gfx_mask_build,
+        (void *)rgb_gfx_collide,
+        (void *)rgb_gfx_collide_flip,
+        (void *)rgb_display_mark_dirty,
+        (void *)rgb_display_get_dirty_tiles,
+        (void *)rgb_display_clear_dirty,
+        (void *)rgb_display_set_double_buffer,
+        (void *)rgb_display_flip,
+        (void *)rgb_display_get_flip_stats,
+        (void *)rgb_display_set_virtual_size,
+        (void *)rgb_display_set_viewport,
+        (void *)rgb_display_get_viewport,
+        (void *)rgb_display_set_viewport_wrap,
+        (void *)rgb_display_get_view_size,
+        (void *)rgb_display_get_fb_stride,
+        (void *)rgb_display_set_external_framebuffer,
+        (void *)rgb_display_set_custom_mode,
+        (void *)rgb_display_set_smoothing,
+        (void *)rgb_display_get_scaler_stats,
+        (void *)rgb_display_set_crt_effect,
+        (void *)rgb_display_start_transition,
+        (void *)rgb_display_transition_busy,
     };
     (void)exports; // suppress unused warning
 
@@ -424,12 +1407,12 @@ void rgb_display_init(void)
     esp_lcd_rgb_panel_config_t panel_config = {
         .clk_src = LCD_CLK_SRC_DEFAULT,
         .timings = {
-            .pclk_hz = 20 * 1000 * 1000,
+            .pclk_hz = LCD_PCLK_HZ,
             .h_res = SCREEN_WIDTH,
             .v_res = SCREEN_HEIGHT,
-            .hsync_pulse_width = 162,
-            .hsync_back_porch = 152,
-            .hsync_front_porch = 48,
+            .hsync_pulse_width = LCD_HSYNC_PULSE_WIDTH,
+            .hsync_back_porch = LCD_HSYNC_BACK_PORCH,
+            .hsync_front_porch = LCD_HSYNC_FRONT_PORCH,
             .vsync_pulse_width = 45,
             .vsync_back_porch = 13,
             .vsync_front_porch = 3,
@@ -494,29 +1477,96 @@ screen_mode_t rgb_display_get_mode(void)
     return s_screen_mode;
 }
 
+// Start a switch into a graphics mode. From text mode, notify the external
+// system; from another graphics mode, blank the output and drop the old framebuffer.
+static int begin_graphics_switch(void)
+{
+    if (s_screen_mode == SM_TEXT) {
+        // Notify external system to save text state and redirect console
+        if (s_callbacks && s_callbacks->enter_graphics) {
+            if (s_callbacks->enter_graphics() != 0) return -1;
+        }
+        return 0;
+    }
+
+    s_scan_fb = NULL;
+    rgb_display_wait_vsync();
+    free_graphics_framebuffer();
+    return 0;
+}
+
+// Roll back a graphics switch that failed after begin_graphics_switch()
+static void abort_graphics_switch(void)
+{
+    if (s_screen_mode != SM_TEXT) {
+        rgb_display_set_mode(SM_TEXT);  // Old framebuffer is gone: fall back to text
+    } else if (s_callbacks && s_callbacks->exit_graphics) {
+        s_callbacks->exit_graphics();
+    }
+}
+
+// SM_RGB565_FULL has no lower-resolution fallback, so before it goes live,
+// time band copies from the freshly cleared (uncached) framebuffer at four
+// points down the frame. The second-slowest band is the one compared with
+// the budget, so one band stretched by an interrupt can't reject the mode.
+static int probe_rgb565_full(void)
+{
+    uint16_t *line = heap_caps_malloc(SCREEN_WIDTH * 2, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!line) return -1;
+
+    uint32_t worst = 0, second = 0;
+    for (int y0 = 0; y0 < SCREEN_HEIGHT; y0 += SCREEN_HEIGHT / 4) {
+        uint32_t t0 = esp_cpu_get_cycle_count();
+        for (int y = y0; y < y0 + BOUNCE_HEIGHT_PX; y++) {
+            copy_rgb565_band(line, s_graphics_framebuffer, y, 1);
+        }
+        uint32_t cycles = esp_cpu_get_cycle_count() - t0;
+        if (cycles > worst) {
+            second = worst;
+            worst = cycles;
+        } else if (cycles > second) {
+            second = cycles;
+        }
+    }
+    heap_caps_free(line);
+
+    if (second > BAND_BUDGET_CYCLES) {
+        ESP_LOGE(TAG, "RGB565 band copy takes %lu cycles, budget %lu: PSRAM too slow for 1024x600",
+                 (unsigned long)second, (unsigned long)BAND_BUDGET_CYCLES);
+        return -1;
+    }
+    return 0;
+}
+
 int rgb_display_set_mode(screen_mode_t mode)
 {
     if (mode == s_screen_mode) {
         return 0;  // Already in this mode
     }
 
-    if (mode == SM_VGA13H || mode == SM_150P) {
-        // Notify external system to save text state and redirect console
-        if (s_callbacks && s_callbacks->enter_graphics) {
-            if (s_callbacks->enter_graphics() != 0) return -1;
-        }
+    if (mode == SM_VGA13H || mode == SM_150P || mode == SM_MONO ||
+        mode == SM_16C_512 || mode == SM_16C_1024 || mode == SM_CGA4 || mode == SM_RGB565 ||
+        mode == SM_RGB565_FULL || mode == SM_MODEX) {
+        if (begin_graphics_switch() != 0) return -1;
 
         // Switch to graphics mode
         if (allocate_graphics_framebuffer(mode) != 0) {
-            // Rollback
-            if (s_callbacks && s_callbacks->exit_graphics)
-                s_callbacks->exit_graphics();
+            abort_graphics_switch();
+            return -1;
+        }
+        if (mode == SM_RGB565_FULL && probe_rgb565_full() != 0) {
+            free_graphics_framebuffer();
+            abort_graphics_switch();
             return -1;
         }
         s_screen_mode = mode;
         s_display_buffer = NULL;  // Disable text buffer pointer
-        ESP_LOGI(TAG, "Switched to %s mode",
-                mode == SM_VGA13H ? "VGA13H (320x200)" : "150P (256x150)");
+        s_scan_fb = s_graphics_framebuffer;  // Last: the scaler dispatches on everything above
+        ESP_LOGI(TAG, "Switched to %s mode (%dx%d, %dbpp)",
+                mode == SM_VGA13H ? "VGA13H" : mode == SM_150P ? "150P" :
+                mode == SM_MONO ? "MONO" : mode == SM_CGA4 ? "CGA 04h" : mode == SM_MODEX ? "Mode X" :
+                mode == SM_RGB565 || mode == SM_RGB565_FULL ? "RGB565" : "16-colour",
+                s_view_width, s_view_height, s_fb_bpp);
     }
     else if (mode == SM_TEXT) {
         // Switch back to text mode
@@ -550,20 +1600,639 @@ uint8_t *rgb_display_get_framebuffer(void)
     return s_graphics_framebuffer;
 }
 
+int rgb_display_set_external_framebuffer(uint8_t *pixels, int width, int height, int stride, int scale)
+{
+    if (!pixels || width <= 0 || height <= 0 || stride < width || scale < 0) return -1;
+    if (width > SCREEN_WIDTH || height > SCREEN_HEIGHT) return -1;
+    if (width * scale > SCREEN_WIDTH || height * scale > SCREEN_HEIGHT) return -1;
+
+    // Same geometry: swap buffers at the next vsync (the app's own double buffering)
+    if (s_screen_mode == SM_EXTERNAL && width == s_gfx_width && height == s_gfx_height &&
+        stride == s_fb_stride && scale == s_gfx_scale) {
+        s_graphics_framebuffer = pixels;
+        s_flip_pending = pixels;
+        return 0;
+    }
+
+    if (begin_graphics_switch() != 0) return -1;
+
+    // Centre the scaled image; the driver allocates no pixel memory
+    s_gfx_width = s_view_width = width;
+    s_gfx_height = s_view_height = height;
+    if (scale) {
+        s_gfx_scale = scale;
+        setup_scaler(width * scale, height * scale);
+    } else {
+        int out_w, out_h;
+        fit_to_panel(width, height, &out_w, &out_h);
+        s_gfx_scale = 0;
+        setup_scaler(out_w, out_h);
+    }
+    s_fb_stride = stride;
+    s_fb_external = true;
+    s_view_x = s_view_y = s_view_x_req = s_view_y_req = 0;
+    s_view_wrap = false;
+    s_graphics_framebuffer = pixels;
+    allocate_dirty_map();
+
+    s_screen_mode = SM_EXTERNAL;
+    s_display_buffer = NULL;
+    s_scan_fb = pixels;
+    ESP_LOGI(TAG, "External framebuffer %dx%d (stride %d) at %dx", width, height, stride, scale);
+    return 0;
+}
+
+int rgb_display_set_custom_mode(int width, int height, bool keep_aspect)
+{
+    if (width <= 0 || height <= 0 || width > SCREEN_WIDTH || height > SCREEN_HEIGHT) return -1;
+    if (begin_graphics_switch() != 0) return -1;
+
+    int out_w = SCREEN_WIDTH, out_h = SCREEN_HEIGHT;
+    if (keep_aspect) fit_to_panel(width, height, &out_w, &out_h);
+
+    s_gfx_width = s_view_width = width;
+    s_gfx_height = s_view_height = height;
+    s_view_wrap = false;
+
+    // Whole-number ratios keep the fixed-scale path
+    bool integer = out_w % width == 0 && out_h % height == 0 && out_w / width == out_h / height;
+    s_gfx_scale = integer ? out_w / width : 0;
+    setup_scaler(out_w, out_h);
+
+    if (allocate_framebuffer_pages() != 0) {
+        abort_graphics_switch();
+        return -1;
+    }
+    s_screen_mode = SM_CUSTOM;
+    s_display_buffer = NULL;
+    s_scan_fb = s_graphics_framebuffer;
+    ESP_LOGI(TAG, "Switched to custom mode %dx%d (shown %dx%d)", width, height, out_w, out_h);
+    return 0;
+}
+
+// --- Bitmap + attribute mode ---
+
+int rgb_display_set_attr_mode(int width, int block_height)
+{
+    if (width != SCREEN_WIDTH && width != SCREEN_WIDTH / 2) return -1;
+    if (block_height != 8 && block_height != 16) return -1;
+    if (begin_graphics_switch() != 0) return -1;
+
+    s_gfx_width = s_view_width = width;
+    s_gfx_height = s_view_height = width * SCREEN_HEIGHT / SCREEN_WIDTH;
+    s_gfx_scale = SCREEN_WIDTH / width;
+    s_view_wrap = false;
+    s_fb_bpp = 1;
+    s_attr_shift = block_height == 8 ? 3 : 4;
+    int attr_rows = (s_gfx_height + block_height - 1) >> s_attr_shift;
+    s_attr_bytes = (width / 8) * attr_rows;
+    setup_scaler(SCREEN_WIDTH, SCREEN_HEIGHT);
+
+    if (allocate_framebuffer_pages() != 0) {
+        abort_graphics_switch();
+        return -1;
+    }
+    memset(s_graphics_framebuffer + s_fb_stride * s_gfx_height, 0x07, s_attr_bytes);  // Grey on black
+    s_screen_mode = SM_ATTR;
+    s_display_buffer = NULL;
+    s_scan_fb = s_graphics_framebuffer;
+    ESP_LOGI(TAG, "Switched to attribute mode %dx%d, 8x%d blocks", width, s_gfx_height, block_height);
+    return 0;
+}
+
+uint8_t *rgb_display_get_attributes(int *cols, int *rows)
+{
+    if (s_screen_mode != SM_ATTR || !s_graphics_framebuffer) return NULL;
+    if (cols) *cols = s_gfx_width / 8;
+    if (rows) *rows = s_attr_bytes / (s_gfx_width / 8);
+    return s_graphics_framebuffer + s_fb_stride * s_gfx_height;
+}
+
+// --- Mode X ---
+
+// Mark the pixels of count plane bytes from offset
+static void modex_mark_dirty(int offset, int count)
+{
+    int y0 = offset / GFX_MODEX_ROW_BYTES;
+    int y1 = (offset + count - 1) / GFX_MODEX_ROW_BYTES;
+    if (y0 == y1) {
+        rgb_display_mark_dirty((offset % GFX_MODEX_ROW_BYTES) * 4, y0, count * 4, 1);
+    } else {
+        rgb_display_mark_dirty(0, y0, GFX_MODEX_WIDTH, y1 - y0 + 1);
+    }
+}
+
+// Plane-interleaved words of the draw page, with count clipped to the memory size
+static uint32_t *modex_words(int offset, int *count)
+{
+    if (s_screen_mode != SM_MODEX || !s_graphics_framebuffer) return NULL;
+    int limit = GFX_MODEX_PLANE_BYTES;
+    if (offset < 0 || offset >= limit || *count <= 0) return NULL;
+    if (*count > limit - offset) *count = limit - offset;
+    return (uint32_t *)s_graphics_framebuffer + offset;
+}
+
+void rgb_display_modex_set_map_mask(uint8_t mask)
+{
+    uint32_t lanes = 0;
+    for (int p = 0; p < 4; p++) {
+        if (mask & (1 << p)) lanes |= 0xFFu << (8 * p);
+    }
+    s_modex_mask = lanes;
+}
+
+void rgb_display_modex_set_read_map(int plane)
+{
+    s_modex_read_map = plane & 3;
+}
+
+void rgb_display_modex_write(int offset, uint8_t value)
+{
+    rgb_display_modex_fill(offset, value, 1);
+}
+
+// Under the full mask each byte is a single 32-bit store of four pixels
+void rgb_display_modex_fill(int offset, uint8_t value, int count)
+{
+    uint32_t *dst = modex_words(offset, &count);
+    if (!dst) return;
+    uint32_t mask = s_modex_mask;
+    uint32_t v = (value * 0x01010101u) & mask;
+
+    if (mask == 0xFFFFFFFF) {
+        for (int i = 0; i < count; i++) dst[i] = v;
+    } else {
+        for (int i = 0; i < count; i++) dst[i] = (dst[i] & ~mask) | v;
+    }
+    modex_mark_dirty(offset, count);
+}
+
+uint8_t rgb_display_modex_read(int offset)
+{
+    int count = 1;
+    uint32_t *src = modex_words(offset, &count);
+    if (!src) return 0;
+    s_modex_latch = *src;
+    return (uint8_t)(s_modex_latch >> (8 * s_modex_read_map));
+}
+
+// Write mode 1: every byte read loads four latches, every write stores them
+// to the masked planes. Forward, byte by byte, as the hardware does.
+void rgb_display_modex_latch_copy(int dst_offset, int src_offset, int count)
+{
+    int n = count;
+    uint32_t *dst = modex_words(dst_offset, &count);
+    uint32_t *src = modex_words(src_offset, &n);
+    if (!dst || !src) return;
+    if (n < count) count = n;
+    uint32_t mask = s_modex_mask;
+
+    for (int i = 0; i < count; i++) {
+        uint32_t latch = src[i];
+        dst[i] = (dst[i] & ~mask) | (latch & mask);
+        s_modex_latch = latch;
+    }
+    modex_mark_dirty(dst_offset, count);
+}
+
+void rgb_display_modex_set_start(int offset)
+{
+    if (s_screen_mode != SM_MODEX) return;
+    s_modex_start_req = offset & (GFX_MODEX_PLANE_BYTES - 1);
+}
+
+// --- Z-buffer ---
+
+int rgb_display_set_zbuffer(bool enable)
+{
+    if (!enable) {
+        if (s_zbuffer) {
+            heap_caps_free(s_zbuffer);
+            s_zbuffer = NULL;
+        }
+        return 0;
+    }
+    if (s_zbuffer) return 0;  // Already allocated
+    if (!s_graphics_framebuffer) return -1;  // Graphics modes only
+
+    int zb_size = s_gfx_width * s_gfx_height * sizeof(uint16_t);
+    s_zbuffer = heap_caps_malloc(zb_size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+#ifdef CONFIG_SPIRAM
+    if (!s_zbuffer) {
+        s_zbuffer = heap_caps_malloc(zb_size, MALLOC_CAP_SPIRAM);
+    }
+#endif
+    if (!s_zbuffer) {
+        ESP_LOGE(TAG, "Failed to allocate z-buffer (%d bytes)", zb_size);
+        return -1;
+    }
+
+    ESP_LOGI(TAG, "Z-buffer in %s at %p (%d bytes)",
+             esp_ptr_internal(s_zbuffer) ? "INTERNAL RAM" : "PSRAM", s_zbuffer, zb_size);
+    memset(s_zbuffer, 0xFF, zb_size);  // Farthest depth
+    return 0;
+}
+
+uint16_t *rgb_display_get_zbuffer(void)
+{
+    return s_zbuffer;
+}
+
+// --- Dirty-tile tracking ---
+
+void rgb_display_mark_dirty(int x, int y, int w, int h)
+{
+    if (!s_dirty_tiles || w <= 0 || h <= 0) return;
+
+    int x0 = x < 0 ? 0 : x;
+    int y0 = y < 0 ? 0 : y;
+    int x1 = x + w > s_gfx_width ? s_gfx_width : x + w;
+    int y1 = y + h > s_gfx_height ? s_gfx_height : y + h;
+    if (x0 >= x1 || y0 >= y1) return;
+
+    int tx0 = x0 >> RGB_DISPLAY_TILE_SHIFT, tx1 = (x1 - 1) >> RGB_DISPLAY_TILE_SHIFT;
+    int ty0 = y0 >> RGB_DISPLAY_TILE_SHIFT, ty1 = (y1 - 1) >> RGB_DISPLAY_TILE_SHIFT;
+    int w0 = tx0 >> 5, w1 = tx1 >> 5;
+    uint32_t m0 = ~0u << (tx0 & 31);
+    uint32_t m1 = ~0u >> (31 - (tx1 & 31));
+
+    uint32_t *row = &s_dirty_tiles[ty0 * s_dirty_words];
+    for (int ty = ty0; ty <= ty1; ty++) {
+        if (w0 == w1) {
+            row[w0] |= m0 & m1;
+        } else {
+            row[w0] |= m0;
+            for (int i = w0 + 1; i < w1; i++) row[i] = ~0u;
+            row[w1] |= m1;
+        }
+        row += s_dirty_words;
+    }
+}
+
+const uint32_t *rgb_display_get_dirty_tiles(int *cols, int *rows, int *words_per_row)
+{
+    if (cols) *cols = s_dirty_tiles ? s_dirty_cols : 0;
+    if (rows) *rows = s_dirty_tiles ? s_dirty_rows : 0;
+    if (words_per_row) *words_per_row = s_dirty_tiles ? s_dirty_words : 0;
+    return s_dirty_tiles;
+}
+
+void rgb_display_clear_dirty(void)
+{
+    if (s_dirty_tiles) {
+        memset(s_dirty_tiles, 0, s_dirty_rows * s_dirty_words * sizeof(uint32_t));
+    }
+}
+
+// --- Page flipping ---
+
+// Queue a page for the next vsync and wait for it to go up. If no vsync comes
+// within the timeout, the page is withdrawn and false returned; the scaler
+// then keeps showing the old page, since swapping mid-frame would tear.
+static bool show_at_vsync(uint8_t *page)
+{
+    if (!s_vsync_sem) return false;
+    xSemaphoreTake(s_vsync_sem, 0);  // Drop a give left by an earlier wait that timed out
+    s_flip_pending = page;
+    s_waiting_for_vsync = true;
+    xSemaphoreTake(s_vsync_sem, pdMS_TO_TICKS(100));  // Timeout ~2 frames
+
+    // The vsync may land between the timeout and here: whoever clears the flip owns it
+    portENTER_CRITICAL(&s_flip_lock);
+    bool shown = s_flip_pending == NULL;
+    s_flip_pending = NULL;
+    portEXIT_CRITICAL(&s_flip_lock);
+    return shown;
+}
+
+int rgb_display_set_double_buffer(rgb_display_flip_mode_t mode)
+{
+    if (!s_graphics_framebuffer || s_fb_external) return -1;  // Own graphics framebuffers only
+    int fb_size = framebuffer_bytes();
+
+    if (mode == RGB_DISPLAY_FLIP_NONE) {
+        if (s_flip_mode != RGB_DISPLAY_FLIP_NONE) {
+            // Show the draw page, and only free the other once the scaler has left it
+            uint8_t *shown = s_scan_fb;
+            if (!show_at_vsync(s_graphics_framebuffer)) return -1;
+            heap_caps_free(shown);
+        }
+        s_flip_mode = mode;
+        return 0;
+    }
+
+    if (s_flip_mode == RGB_DISPLAY_FLIP_NONE) {
+        uint8_t *page = heap_caps_malloc(fb_size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+#ifdef CONFIG_SPIRAM
+        if (!page) {
+            page = heap_caps_malloc(fb_size, MALLOC_CAP_SPIRAM);
+        }
+#endif
+        if (!page) {
+            ESP_LOGE(TAG, "Failed to allocate second page (%d bytes)", fb_size);
+            return -1;
+        }
+        ESP_LOGI(TAG, "Second page in %s at %p (%d bytes)",
+                 esp_ptr_internal(page) ? "INTERNAL RAM" : "PSRAM", page, fb_size);
+
+        // Both pages start identical; drawing continues on the new (hidden) one
+        memcpy(page, s_graphics_framebuffer, fb_size);
+        s_pages[0] = s_graphics_framebuffer;
+        s_pages[1] = page;
+        s_graphics_framebuffer = page;
+        rgb_display_clear_dirty();
+    }
+
+    s_flip_mode = mode;
+    memset(&s_flip_stats, 0, sizeof(s_flip_stats));
+    s_flip_stats.tile_size = RGB_DISPLAY_TILE_SIZE;
+    return 0;
+}
+
+// Copy the dirty tiles of src into dst, one memcpy per run of adjacent tiles per row
+static uint32_t copy_dirty_tiles(uint8_t *dst, const uint8_t *src, uint32_t *tiles_out)
+{
+    uint32_t bytes = 0, tiles = 0;
+    int w = s_gfx_width, h = s_gfx_height;
+    int bpp = s_fb_bpp;
+
+    for (int ty = 0; ty < s_dirty_rows; ty++) {
+        const uint32_t *row = &s_dirty_tiles[ty * s_dirty_words];
+        int y0 = ty << RGB_DISPLAY_TILE_SHIFT;
+        int y1 = y0 + RGB_DISPLAY_TILE_SIZE > h ? h : y0 + RGB_DISPLAY_TILE_SIZE;
+
+        int tx = 0;
+        while (tx < s_dirty_cols) {
+            if (!(row[tx >> 5] & (1u << (tx & 31)))) {
+                tx++;
+                continue;
+            }
+            int run = tx;
+            while (tx < s_dirty_cols && (row[tx >> 5] & (1u << (tx & 31)))) tx++;
+            tiles += tx - run;
+
+            int x0 = run << RGB_DISPLAY_TILE_SHIFT;
+            int x1 = tx << RGB_DISPLAY_TILE_SHIFT;
+            if (x1 > w) x1 = w;
+            int b0 = x0 * bpp / 8, b1 = (x1 * bpp + 7) / 8;  // Tiles are whole bytes at any depth
+            for (int y = y0; y < y1; y++) {
+                memcpy(page_row(dst, y) + b0, page_row((uint8_t *)src, y) + b0, b1 - b0);
+            }
+            bytes += (b1 - b0) * (y1 - y0);
+        }
+    }
+    *tiles_out = tiles;
+    return bytes;
+}
+
+int rgb_display_flip(void)
+{
+    if (s_flip_mode == RGB_DISPLAY_FLIP_NONE || !s_graphics_framebuffer) {
+        rgb_display_wait_vsync();
+        return 0;
+    }
+
+    // Show the finished page from the next vsync; without one, nothing changes
+    uint8_t *done = s_graphics_framebuffer;
+    uint8_t *back = s_scan_fb;
+    if (!show_at_vsync(done)) return -1;
+    s_graphics_framebuffer = back;
+
+    // Bring the new back page up to date with what was just drawn
+    uint32_t bytes = 0, tiles = 0;
+    int fb_size = framebuffer_bytes();
+    if (s_flip_mode == RGB_DISPLAY_FLIP_COPY_ALL || (s_flip_mode == RGB_DISPLAY_FLIP_COPY_DIRTY && !s_dirty_tiles)) {
+        memcpy(back, done, fb_size);
+        bytes = fb_size;
+        tiles = s_dirty_cols * s_dirty_rows;
+    } else if (s_flip_mode == RGB_DISPLAY_FLIP_COPY_DIRTY) {
+        bytes = copy_dirty_tiles(back, done, &tiles);
+        if (s_attr_bytes) {
+            // Attributes are not tile-tracked: always carry them forward
+            int offset = s_fb_stride * s_gfx_height;
+            memcpy(back + offset, done + offset, s_attr_bytes);
+            bytes += s_attr_bytes;
+        }
+    }
+    rgb_display_clear_dirty();
+
+    s_flip_stats.copy_bytes = bytes;
+    s_flip_stats.dirty_tiles = tiles;
+    s_flip_stats.total_tiles = s_dirty_cols * s_dirty_rows;
+    s_flip_stats.flips++;
+    return 0;
+}
+
+void rgb_display_get_flip_stats(rgb_display_flip_stats_t *stats)
+{
+    if (stats) *stats = s_flip_stats;
+}
+
+// --- Virtual framebuffer and viewport ---
+
+int rgb_display_set_virtual_size(int width, int height)
+{
+    if (!s_graphics_framebuffer || s_fb_external || s_flip_mode != RGB_DISPLAY_FLIP_NONE) return -1;
+    if (s_fb_bpp != 8 || s_screen_mode == SM_MODEX) return -1;
+    if (width <= 0) width = s_view_width;
+    if (height <= 0) height = s_view_height;
+    if (width < s_view_width || height < s_view_height) return -1;
+    if (width == s_gfx_width && height == s_gfx_height) return 0;
+
+    // Blank the output until the scaler has let go of the old buffer
+    s_scan_fb = NULL;
+    rgb_display_wait_vsync();
+    free_graphics_framebuffer();
+
+    s_gfx_width = width;
+    s_gfx_height = height;
+    if (allocate_framebuffer_pages() != 0) {
+        // Keep a usable mode at the visible size
+        s_gfx_width = s_view_width;
+        s_gfx_height = s_view_height;
+        allocate_framebuffer_pages();
+        s_scan_fb = s_graphics_framebuffer;
+        return -1;
+    }
+    s_scan_fb = s_graphics_framebuffer;
+    ESP_LOGI(TAG, "Virtual framebuffer %dx%d (view %dx%d)", width, height, s_view_width, s_view_height);
+    return 0;
+}
+
+void rgb_display_set_viewport(int x, int y)
+{
+    if (!s_graphics_framebuffer) return;
+    int max_x = s_gfx_width - s_view_width;
+    int max_y = s_gfx_height - s_view_height;
+
+    if (s_view_wrap) {
+        x %= s_gfx_width;
+        y %= s_gfx_height;
+        if (x < 0) x += s_gfx_width;
+        if (y < 0) y += s_gfx_height;
+    } else {
+        x = x < 0 ? 0 : (x > max_x ? max_x : x);
+        y = y < 0 ? 0 : (y > max_y ? max_y : y);
+    }
+    s_view_x_req = x;
+    s_view_y_req = y;
+}
+
+void rgb_display_get_viewport(int *x, int *y)
+{
+    if (x) *x = s_view_x_req;
+    if (y) *y = s_view_y_req;
+}
+
+void rgb_display_set_viewport_wrap(bool wrap)
+{
+    s_view_wrap = wrap;
+    rgb_display_set_viewport(s_view_x_req, s_view_y_req);  // Re-clamp
+}
+
+void rgb_display_get_view_size(int *width, int *height)
+{
+    if (width) *width = s_view_width;
+    if (height) *height = s_view_height;
+}
+
+// --- Transitions ---
+
+// Threshold patterns over the visible view: spans of columns and rows, or a tile
+static void build_transition_pattern(rgb_display_transition_t type)
+{
+    int cols = (s_view_width + (1 << TRANS_SPAN_SHIFT) - 1) >> TRANS_SPAN_SHIFT;
+    int rows = s_view_height;
+
+    memset(s_trans_col, 0, sizeof(s_trans_col));
+    memset(s_trans_row, 0, sizeof(s_trans_row));
+    s_trans_tiled = false;
+    switch (type) {
+    case RGB_DISPLAY_TRANSITION_WIPE:
+        for (int i = 0; i < cols; i++) s_trans_col[i] = (i * 256) / cols;
+        break;
+    case RGB_DISPLAY_TRANSITION_BLINDS: {
+        int slat = rows / RGB_DISPLAY_BLINDS_SLATS;
+        if (slat < 1) slat = 1;
+        for (int y = 0; y < rows; y++) s_trans_row[y] = ((y % slat) * 256) / slat;
+        break;
+    }
+    case RGB_DISPLAY_TRANSITION_DISSOLVE:
+    default: {
+        // A shuffled tile of every threshold once: each frame switches exactly
+        // its share of every 16x16 block, with no diagonal structure
+        uint8_t *tile = &s_trans_tile[0][0];
+        for (int i = 0; i < 256; i++) tile[i] = i;
+        uint32_t seed = 0x9E3779B9;
+        for (int i = 255; i > 0; i--) {
+            seed ^= seed << 13; seed ^= seed >> 17; seed ^= seed << 5;
+            int j = seed % (i + 1);
+            uint8_t t = tile[i];
+            tile[i] = tile[j];
+            tile[j] = t;
+        }
+        s_trans_tiled = true;
+        break;
+    }
+    }
+}
+
+int rgb_display_start_transition(const uint8_t *from, rgb_display_transition_t type, int frames)
+{
+    if (!s_graphics_framebuffer || s_fb_bpp != 8 || s_screen_mode == SM_MODEX || !from || frames <= 0) return -1;
+
+    // Let a running transition go before its pattern is rebuilt
+    if (s_trans_from) {
+        s_trans_from = NULL;
+        rgb_display_wait_vsync();
+    }
+    build_transition_pattern(type);
+    s_trans_frames = frames;
+    s_trans_frame = 0;
+    s_trans_level = 0;
+    s_trans_from = from;
+    return 0;
+}
+
+bool rgb_display_transition_busy(void)
+{
+    return s_trans_from != NULL;
+}
+
+// --- Scaler options ---
+
+int rgb_display_set_smoothing(bool enable)
+{
+    if (!enable) {
+        s_smooth = false;
+        return 0;
+    }
+    // Integer 2x, 3x and 4x scales only
+    if (s_screen_mode == SM_TEXT || s_fb_bpp != 8 || s_gfx_scale < 2 || s_gfx_scale > 4) return -1;
+    s_overrun_run = 0;
+    s_scaler_stats.fell_back = false;
+    s_smooth = true;
+    return 0;
+}
+
+void rgb_display_get_scaler_stats(rgb_display_scaler_stats_t *stats)
+{
+    if (!stats) return;
+    *stats = s_scaler_stats;
+    stats->band_budget_cycles = BAND_BUDGET_CYCLES;
+    stats->smoothing = s_smooth;
+}
+
+// --- CRT effect ---
+
+static uint16_t dim_rgb565(uint16_t c)
+{
+    int b = s_crt_brightness;
+    uint16_t r = (((c >> 11) & 0x1F) * b) >> 8;
+    uint16_t g = (((c >> 5) & 0x3F) * b) >> 8;
+    uint16_t bl = ((c & 0x1F) * b) >> 8;
+    return (r << 11) | (g << 5) | bl;
+}
+
+void rgb_display_set_crt_effect(uint8_t line_mask, uint8_t column_mask, int brightness)
+{
+    if (brightness < 0) brightness = 0;
+    if (brightness > 256) brightness = 256;
+
+    s_crt_on = false;
+    s_crt_lines = line_mask;
+    s_crt_columns = column_mask;
+    s_crt_brightness = brightness;
+    for (int i = 0; i < 256; i++) s_vga_palette_dim[i] = dim_rgb565(s_vga_palette[i]);
+    for (int y = 0; y < SCREEN_HEIGHT; y++) {
+        s_line_dim[y] = s_ysub[y] < 8 && ((line_mask >> s_ysub[y]) & 1);
+    }
+    s_crt_on = line_mask || column_mask;
+}
+
 // --- VGA Palette API ---
 
 void rgb_display_set_vga_palette(const uint16_t palette[256])
 {
     memcpy(s_vga_palette, palette, sizeof(s_vga_palette));
+    for (int i = 0; i < 256; i++) s_vga_palette_dim[i] = dim_rgb565(palette[i]);
+    rebuild_nibble_lut();
 }
 
 void rgb_display_set_vga_palette_entry(int index, uint16_t rgb565)
 {
     if (index >= 0 && index < 256) {
         s_vga_palette[index] = rgb565;
+        s_vga_palette_dim[index] = dim_rgb565(rgb565);
+        if (index < 16) rebuild_nibble_lut();
     }
 }
 
+const uint16_t *rgb_display_get_vga_palette(void)
+{
+    return s_vga_palette;
+}
+
 uint16_t rgb_display_get_vga_palette_entry(int index)
 {
     if (index >= 0 && index < 256) {
@@ -576,7 +2245,8 @@ uint16_t rgb_display_get_vga_palette_entry(int index)
 
 void rgb_display_wait_vsync(void)
 {
-    if ((s_screen_mode != SM_VGA13H && s_screen_mode != SM_150P) || !s_vsync_sem) return;
+    if (s_screen_mode == SM_TEXT || !s_vsync_sem) return;
+    xSemaphoreTake(s_vsync_sem, 0);  // Drop a give left by an earlier wait that timed out
     s_waiting_for_vsync = true;
     xSemaphoreTake(s_vsync_sem, pdMS_TO_TICKS(100));  // Timeout ~2 frames
 }
@@ -592,3 +2262,47 @@ int rgb_display_get_fb_height(void)
 {
     return s_gfx_height;
 }
+
+int rgb_display_get_fb_stride(void)
+{
+    return s_fb_stride;
+}
+
+int rgb_display_get_fb_bpp(void)
+{
+    return s_fb_bpp;
+}
+
+int rgb_display_get_fb_bank(void)
+{
+    return s_fb_bank;
+}
+
+void rgb_display_get_fb_info(rgb_display_fb_info_t *info)
+{
+    info->pixels = s_graphics_framebuffer;
+    info->width = s_gfx_width;
+    info->height = s_gfx_height;
+    info->stride = s_fb_stride;
+    info->bpp = s_fb_bpp;
+    info->bank = s_fb_bank;
+    info->palette = s_vga_palette;
+    info->dirty_tiles = s_dirty_tiles;
+    info->dirty_words = s_dirty_words;
+}
+
+void rgb_display_set_cga_palette(int palette, bool intensity, int background)
+{
+    s_cga_palette = palette & 1;
+    s_cga_intensity = intensity;
+    s_cga_background = background & 0x0F;
+    rebuild_cga_lut();
+}
+
+void rgb_display_set_mono_colors(uint16_t fg, uint16_t bg)
+{
+    uint32_t bg32 = ((uint32_t)bg << 16) | bg;
+    uint32_t fg32 = ((uint32_t)fg << 16) | fg;
+    s_mono_bg32 = bg32;
+    s_mono_xor32 = fg32 ^ bg32;
+}
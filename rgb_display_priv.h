@@ -0,0 +1,20 @@
+/*
+ * rgb_display_priv.h - Display state shared between rgb_display.c and rgb_gfx.c
+ *
+ * Not part of the public API: the dirty-tile map is handed out writable here so
+ * the drawing code can mark single tiles without a call per pixel.
+ */
+
+#pragma once
+#include <stdint.h>
+
+// Framebuffer state in one call, for drawing code that needs several per primitive
+typedef struct {
+    uint8_t *pixels;          // rgb_display_get_framebuffer()
+    int width, height, stride, bpp, bank;
+    const uint16_t *palette;  // rgb_display_get_vga_palette()
+    uint32_t *dirty_tiles;    // Dirty-tile map (NULL if untracked), for marking single tiles
+    int dirty_words;          // Words per dirty-map row
+} rgb_display_fb_info_t;
+
+void rgb_display_get_fb_info(rgb_display_fb_info_t *info);
@@ -1,43 +1,212 @@
 /*
- * rgb_gfx.c - Graphics primitives for 8bpp indexed color modes
+ * rgb_gfx.c - Graphics primitives for 8bpp indexed color modes (and packed 1/2/4bpp modes)
  */
 
 #include "rgb_gfx.h"
 #include "rgb_display.h"
+#include "rgb_display_priv.h"
+#include "esp_heap_caps.h"
 #include <string.h>
 
 // External font data (8x16 terminus font, 224 glyphs from 0x20-0xFF)
 extern const uint8_t terminus16_glyph_bitmap[];
 
-// Get current framebuffer and dimensions (cached per-call for speed)
-static inline uint8_t *get_fb(int *w, int *h) {
-    *w = rgb_display_get_fb_width();
-    *h = rgb_display_get_fb_height();
-    return rgb_display_get_framebuffer();
+// Framebuffer state, and its pixel depth and row layout, refreshed by get_fb()
+static rgb_display_fb_info_t s_fb;
+static int s_bpp = 8;
+static int s_bank = 0;  // Offset of the odd-row bank (CGA interlace), 0 = linear rows
+static const uint16_t *s_pal;  // VGA palette: colours of 8-bit draws on 16bpp framebuffers
+
+// Get current framebuffer, dimensions and row stride (one call per primitive)
+static inline uint8_t *get_fb(int *w, int *h, int *stride) {
+    rgb_display_get_fb_info(&s_fb);
+    *w = s_fb.width;
+    *h = s_fb.height;
+    *stride = s_fb.stride;
+    s_bpp = s_fb.bpp;
+    s_bank = s_fb.bank;
+    s_pal = s_fb.palette;
+    return s_fb.pixels;
+}
+
+// As get_fb(), for the direct-colour primitives (NULL unless 16bpp)
+static inline uint8_t *get_fb16(int *w, int *h, int *stride) {
+    uint8_t *fb = get_fb(w, h, stride);
+    return s_bpp == 16 ? fb : NULL;
+}
+
+// Start of framebuffer row y, for primitives that draw packed framebuffers
+static inline uint8_t *fb_row(uint8_t *fb, int stride, int y)
+{
+    if (s_bank) return fb + (y & 1) * s_bank + (y >> 1) * stride;
+    return fb + y * stride;
+}
+
+// As get_fb(), for primitives that only draw 8bpp framebuffers (NULL otherwise)
+static inline uint8_t *get_fb8(int *w, int *h, int *stride) {
+    uint8_t *fb = get_fb(w, h, stride);
+    return s_bpp == 8 ? fb : NULL;
+}
+
+// --- Packed pixel rows (1, 2 and 4bpp) ---
+//
+// The leftmost pixel sits in the most significant bits of each byte. Spans
+// store whole bytes with memset and merge the partial bytes at either end.
+
+// Pixel values the current depth can hold (packed depths keep the low bits)
+static inline uint8_t color_mask(void)
+{
+    return s_bpp < 8 ? (1 << s_bpp) - 1 : 0xFF;
+}
+
+static void packed_fill(uint8_t *row, int x0, int x1, uint8_t color)
+{
+    int ppb = 8 / s_bpp;  // Pixels per byte
+    uint8_t pix = color & ((1 << s_bpp) - 1);
+    uint8_t fill = pix * (0xFF / ((1 << s_bpp) - 1));  // Pixel repeated across the byte
+    int b0 = x0 / ppb, b1 = x1 / ppb;
+    uint8_t head = 0xFF >> ((x0 % ppb) * s_bpp);           // Pixels from x0 in byte b0
+    uint8_t tail = ~(0xFF >> ((x1 % ppb) * s_bpp));        // Pixels before x1 in byte b1
+
+    if (b0 == b1) {
+        uint8_t m = head & tail;
+        row[b0] = (row[b0] & ~m) | (fill & m);
+        return;
+    }
+    row[b0] = (row[b0] & ~head) | (fill & head);
+    memset(row + b0 + 1, fill, b1 - b0 - 1);
+    if (tail) row[b1] = (row[b1] & ~tail) | (fill & tail);
+}
+
+// Fill pixels [x0, x1) of a 16bpp row, two pixels per 32-bit store
+static void fill16(uint16_t *row, int x0, int x1, uint16_t color)
+{
+    if (x0 >= x1) return;
+    if (x0 & 1) row[x0++] = color;
+    uint32_t pair = ((uint32_t)color << 16) | color;
+    uint32_t *p = (uint32_t *)(row + x0);
+    for (int n = (x1 - x0) >> 1; n > 0; n--) *p++ = pair;
+    if ((x1 - x0) & 1) row[x1 - 1] = color;
+}
+
+static inline void packed_put(uint8_t *row, int x, uint8_t color)
+{
+    int ppb = 8 / s_bpp;
+    int shift = 8 - s_bpp * (x % ppb + 1);
+    uint8_t m = ((1 << s_bpp) - 1) << shift;
+    row[x / ppb] = (row[x / ppb] & ~m) | ((color << shift) & m);
+}
+
+static inline uint8_t packed_get(const uint8_t *row, int x)
+{
+    int ppb = 8 / s_bpp;
+    return (row[x / ppb] >> (8 - s_bpp * (x % ppb + 1))) & ((1 << s_bpp) - 1);
+}
+
+// Fill pixels [x0, x1) of a framebuffer row at the current depth. At 16bpp
+// the colour index is looked up in the VGA palette.
+static inline void row_fill(uint8_t *row, int x0, int x1, uint8_t color)
+{
+    if (s_bpp == 8) memset(row + x0, color, x1 - x0);
+    else if (s_bpp == 16) fill16((uint16_t *)row, x0, x1, s_pal[color]);
+    else packed_fill(row, x0, x1, color);
+}
+
+static inline void row_put(uint8_t *row, int x, uint8_t color)
+{
+    if (s_bpp == 8) row[x] = color;
+    else if (s_bpp == 16) ((uint16_t *)row)[x] = s_pal[color];
+    else packed_put(row, x, color);
+}
+
+// Pixel index at x (indexed depths only)
+static inline uint8_t row_get(const uint8_t *row, int x)
+{
+    return s_bpp == 8 ? row[x] : packed_get(row, x);
+}
+
+#define SWAP_INT(a, b) do { int _t = (a); (a) = (b); (b) = _t; } while (0)
+
+// Record the bounding box (inclusive corners) of a draw in the dirty-tile map.
+// Primitives mark once per call, not per pixel or span.
+static inline void mark_box(int x0, int y0, int x1, int y1)
+{
+    rgb_display_mark_dirty(x0, y0, x1 - x0 + 1, y1 - y0 + 1);
+}
+
+// Mark the tile of one on-screen pixel, without a call (after get_fb())
+static inline void mark_pixel(int x, int y)
+{
+    if (s_fb.dirty_tiles) {
+        int tx = x >> RGB_DISPLAY_TILE_SHIFT;
+        s_fb.dirty_tiles[(y >> RGB_DISPLAY_TILE_SHIFT) * s_fb.dirty_words + (tx >> 5)] |= 1u << (tx & 31);
+    }
+}
+
+// --- Scanline rasterisation helpers ---
+//
+// Edges are stepped in 16.16 fixed point and sampled at pixel centres
+// (y + 0.5), so polygons sharing an edge never overdraw or leave gaps.
+
+typedef struct {
+    int32_t x;      // X at the centre of the current scanline (16.16)
+    int32_t dx;     // X step per scanline (16.16)
+} edge_t;
+
+// Set up an edge from (xa, ya) to (xb, yb), positioned at scanline y. Requires yb > ya.
+static inline void edge_init(edge_t *e, int xa, int ya, int xb, int yb, int y)
+{
+    e->dx = (int32_t)(((int64_t)(xb - xa) << 16) / (yb - ya));
+    e->x = (int32_t)(((int64_t)xa << 16) + (int64_t)(y - ya) * e->dx + e->dx / 2);
+}
+
+// Fill pixels xa..xb (inclusive) of row y, clipped to the framebuffer
+static inline void fill_span(uint8_t *fb, int stride, int w, int h, int y, int xa, int xb, uint8_t color)
+{
+    if (y < 0 || y >= h) return;
+    if (xa < 0) xa = 0;
+    if (xb >= w) xb = w - 1;
+    if (xa <= xb) row_fill(fb_row(fb, stride, y), xa, xb + 1, color);
+}
+
+// Fill the pixel centres inside [xl, xr) (16.16) on one framebuffer row, clipped once
+static inline void fill_span_fx(uint8_t *row, int w, int32_t xl, int32_t xr, uint8_t color)
+{
+    int x0 = (xl + 0x7FFF) >> 16;
+    int x1 = (xr + 0x7FFF) >> 16;
+    if (x0 < 0) x0 = 0;
+    if (x1 > w) x1 = w;
+    if (x0 < x1) row_fill(row, x0, x1, color);
 }
 
 void rgb_gfx_clear(uint8_t color)
 {
-    int w, h;
-    uint8_t *fb = get_fb(&w, &h);
+    int w, h, stride;
+    uint8_t *fb = get_fb(&w, &h, &stride);
     if (fb && w > 0 && h > 0) {
-        memset(fb, color, w * h);
+        if (stride == w && s_bpp == 8) {
+            memset(fb, color, w * h);
+        } else {
+            for (int y = 0; y < h; y++) row_fill(fb_row(fb, stride, y), 0, w, color);
+        }
+        rgb_display_mark_dirty(0, 0, w, h);
     }
 }
 
 void rgb_gfx_pixel(int x, int y, uint8_t color)
 {
-    int w, h;
-    uint8_t *fb = get_fb(&w, &h);
+    int w, h, stride;
+    uint8_t *fb = get_fb(&w, &h, &stride);
     if (fb && x >= 0 && x < w && y >= 0 && y < h) {
-        fb[y * w + x] = color;
+        row_put(fb_row(fb, stride, y), x, color);
+        mark_pixel(x, y);
     }
 }
 
 void rgb_gfx_hline(int x, int y, int len, uint8_t color)
 {
-    int w, h;
-    uint8_t *fb = get_fb(&w, &h);
+    int w, h, stride;
+    uint8_t *fb = get_fb(&w, &h, &stride);
     if (!fb || y < 0 || y >= h || len <= 0) return;
 
     // Clip to screen bounds
@@ -45,13 +214,14 @@ void rgb_gfx_hline(int x, int y, int len, uint8_t color)
     if (x + len > w) { len = w - x; }
     if (len <= 0) return;
 
-    memset(&fb[y * w + x], color, len);
+    row_fill(fb_row(fb, stride, y), x, x + len, color);
+    rgb_display_mark_dirty(x, y, len, 1);
 }
 
 void rgb_gfx_vline(int x, int y, int len, uint8_t color)
 {
-    int w, h;
-    uint8_t *fb = get_fb(&w, &h);
+    int w, h, stride;
+    uint8_t *fb = get_fb(&w, &h, &stride);
     if (!fb || x < 0 || x >= w || len <= 0) return;
 
     // Clip to screen bounds
@@ -59,11 +229,10 @@ void rgb_gfx_vline(int x, int y, int len, uint8_t color)
     if (y + len > h) { len = h - y; }
     if (len <= 0) return;
 
-    uint8_t *p = &fb[y * w + x];
     for (int i = 0; i < len; i++) {
-        *p = color;
-        p += w;
+        row_put(fb_row(fb, stride, y + i), x, color);
     }
+    rgb_display_mark_dirty(x, y, 1, len);
 }
 
 void rgb_gfx_rect(int x, int y, int rw, int rh, uint8_t color)
@@ -83,8 +252,8 @@ void rgb_gfx_rect(int x, int y, int rw, int rh, uint8_t color)
 
 void rgb_gfx_rectfill(int x, int y, int rw, int rh, uint8_t color)
 {
-    int w, h;
-    uint8_t *fb = get_fb(&w, &h);
+    int w, h, stride;
+    uint8_t *fb = get_fb(&w, &h, &stride);
     if (!fb || rw <= 0 || rh <= 0) return;
 
     // Clip to screen bounds
@@ -99,36 +268,95 @@ void rgb_gfx_rectfill(int x, int y, int rw, int rh, uint8_t color)
     int clipped_w = x1 - x0;
     int clipped_h = y1 - y0;
     if (clipped_w <= 0 || clipped_h <= 0) return;
+    rgb_display_mark_dirty(x0, y0, clipped_w, clipped_h);
 
-    // Fast path: use memset for each row
+    // Fast path: one span fill (memset of whole bytes) per row
     for (int row = y0; row < y1; row++) {
-        memset(&fb[row * w + x0], color, clipped_w);
+        row_fill(fb_row(fb, stride, row), x0, x1, color);
     }
 }
 
+// Clip a sw x sh blit at (*x, *y) to the framebuffer, once per call.
+// On success *x, *y, *cw, *ch hold the visible destination rect and
+// *ox, *oy the offset of its top-left corner within the sprite.
+static bool clip_blit(int *x, int *y, int sw, int sh, int w, int h,
+                      int *cw, int *ch, int *ox, int *oy)
+{
+    int x0 = *x, y0 = *y, x1 = *x + sw, y1 = *y + sh;
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 > w) x1 = w;
+    if (y1 > h) y1 = h;
+    if (x0 >= x1 || y0 >= y1) return false;
+
+    *ox = x0 - *x;
+    *oy = y0 - *y;
+    *x = x0;
+    *y = y0;
+    *cw = x1 - x0;
+    *ch = y1 - y0;
+    return true;
+}
+
 void rgb_gfx_blit(const uint8_t *data, int x, int y, int sw, int sh,
                  int src_stride, int transparent_color)
 {
-    int w, h;
-    uint8_t *fb = get_fb(&w, &h);
+    int w, h, stride, cw, ch, ox, oy;
+    uint8_t *fb = get_fb(&w, &h, &stride);
     if (!fb || !data || sw <= 0 || sh <= 0) return;
+    if (!clip_blit(&x, &y, sw, sh, w, h, &cw, &ch, &ox, &oy)) return;
+    rgb_display_mark_dirty(x, y, cw, ch);
 
-    for (int sy = 0; sy < sh; sy++) {
-        int dy = y + sy;
-        if (dy < 0 || dy >= h) continue;
+    const uint8_t *src_row = &data[oy * src_stride + ox];
 
-        const uint8_t *src_row = &data[sy * src_stride];
-        uint8_t *dst_row = &fb[dy * w];
-
-        for (int sx = 0; sx < sw; sx++) {
-            int dx = x + sx;
-            if (dx < 0 || dx >= w) continue;
+    if (s_bpp == 4 && transparent_color < 0) {
+        // Opaque 4bpp: whole bytes from source pixel pairs, odd edges by pixel
+        int head = x & 1;
+        int pairs = (cw - head) >> 1;
+        for (int r = 0; r < ch; r++) {
+            uint8_t *row = fb_row(fb, stride, y + r);
+            const uint8_t *src = src_row;
+            if (head) row_put(row, x, *src++);
+            uint8_t *dst = &row[(x + head) >> 1];
+            for (int i = 0; i < pairs; i++, src += 2) *dst++ = (src[0] << 4) | (src[1] & 0x0F);
+            if ((cw - head) & 1) row_put(row, x + cw - 1, *src);
+            src_row += src_stride;
+        }
+        return;
+    }
 
-            uint8_t pixel = src_row[sx];
-            if (transparent_color < 0 || pixel != (uint8_t)transparent_color) {
-                dst_row[dx] = pixel;
+    if (s_bpp != 8) {
+        // Packed (or 16bpp) framebuffer: convert the 8bpp source pixel by pixel
+        for (int r = 0; r < ch; r++) {
+            uint8_t *row = fb_row(fb, stride, y + r);
+            for (int i = 0; i < cw; i++) {
+                uint8_t pixel = src_row[i];
+                if (transparent_color < 0 || pixel != (uint8_t)transparent_color) row_put(row, x + i, pixel);
             }
+            src_row += src_stride;
+        }
+        return;
+    }
+
+    uint8_t *dst_row = &fb[y * stride + x];
+    if (transparent_color < 0) {
+        // Opaque: straight row copies
+        for (int row = 0; row < ch; row++) {
+            memcpy(dst_row, src_row, cw);
+            src_row += src_stride;
+            dst_row += stride;
+        }
+        return;
+    }
+
+    uint8_t key = (uint8_t)transparent_color;
+    for (int row = 0; row < ch; row++) {
+        for (int i = 0; i < cw; i++) {
+            uint8_t pixel = src_row[i];
+            if (pixel != key) dst_row[i] = pixel;
         }
+        src_row += src_stride;
+        dst_row += stride;
     }
 }
 
@@ -136,27 +364,1515 @@ void rgb_gfx_blit_flip(const uint8_t *data, int x, int y, int sw, int sh,
                       int src_stride, int transparent_color,
                       bool flip_x, bool flip_y)
 {
-    int w, h;
-    uint8_t *fb = get_fb(&w, &h);
+    int w, h, stride, cw, ch, ox, oy;
+    uint8_t *fb = get_fb(&w, &h, &stride);
     if (!fb || !data || sw <= 0 || sh <= 0) return;
+    if (!clip_blit(&x, &y, sw, sh, w, h, &cw, &ch, &ox, &oy)) return;
+    rgb_display_mark_dirty(x, y, cw, ch);
 
-    for (int sy = 0; sy < sh; sy++) {
-        int src_y = flip_y ? (sh - 1 - sy) : sy;
-        int dy = y + sy;
-        if (dy < 0 || dy >= h) continue;
+    // Walk the source backwards along flipped axes
+    int src_x = flip_x ? sw - 1 - ox : ox;
+    int src_y = flip_y ? sh - 1 - oy : oy;
+    int step_x = flip_x ? -1 : 1;
+    int step_y = flip_y ? -src_stride : src_stride;
 
-        const uint8_t *src_row = &data[src_y * src_stride];
-        uint8_t *dst_row = &fb[dy * w];
+    const uint8_t *src_row = &data[src_y * src_stride + src_x];
 
-        for (int sx = 0; sx < sw; sx++) {
-            int src_x = flip_x ? (sw - 1 - sx) : sx;
-            int dx = x + sx;
-            if (dx < 0 || dx >= w) continue;
-
-            uint8_t pixel = src_row[src_x];
+    for (int row = 0; row < ch; row++) {
+        uint8_t *dst_row = fb_row(fb, stride, y + row);
+        const uint8_t *src = src_row;
+        for (int i = 0; i < cw; i++) {
+            uint8_t pixel = *src;
+            src += step_x;
             if (transparent_color < 0 || pixel != (uint8_t)transparent_color) {
-                dst_row[dx] = pixel;
+                row_put(dst_row, x + i, pixel);
+            }
+        }
+        src_row += step_y;
+    }
+}
+
+void rgb_gfx_read_rect(int x, int y, int rw, int rh, uint8_t *dst, int dst_stride)
+{
+    int w, h, stride, cw, ch, ox, oy;
+    uint8_t *fb = get_fb(&w, &h, &stride);
+    if (!fb || s_bpp == 16 || !dst || rw <= 0 || rh <= 0) return;
+    if (!clip_blit(&x, &y, rw, rh, w, h, &cw, &ch, &ox, &oy)) return;
+
+    uint8_t *dst_row = &dst[oy * dst_stride + ox];
+    for (int row = 0; row < ch; row++) {
+        const uint8_t *src_row = fb_row(fb, stride, y + row);
+        if (s_bpp == 8) {
+            memcpy(dst_row, src_row + x, cw);
+        } else {
+            for (int i = 0; i < cw; i++) dst_row[i] = row_get(src_row, x + i);
+        }
+        dst_row += dst_stride;
+    }
+}
+
+// --- Direct colour (16bpp) ---
+
+void rgb_gfx_clear16(uint16_t color)
+{
+    int w, h, stride;
+    uint8_t *fb = get_fb16(&w, &h, &stride);
+    if (!fb) return;
+    for (int y = 0; y < h; y++) fill16((uint16_t *)&fb[y * stride], 0, w, color);
+    rgb_display_mark_dirty(0, 0, w, h);
+}
+
+void rgb_gfx_pixel16(int x, int y, uint16_t color)
+{
+    int w, h, stride;
+    uint8_t *fb = get_fb16(&w, &h, &stride);
+    if (fb && x >= 0 && x < w && y >= 0 && y < h) {
+        ((uint16_t *)&fb[y * stride])[x] = color;
+        mark_pixel(x, y);
+    }
+}
+
+void rgb_gfx_hline16(int x, int y, int len, uint16_t color)
+{
+    rgb_gfx_rectfill16(x, y, len, 1, color);
+}
+
+void rgb_gfx_vline16(int x, int y, int len, uint16_t color)
+{
+    rgb_gfx_rectfill16(x, y, 1, len, color);
+}
+
+void rgb_gfx_rectfill16(int x, int y, int rw, int rh, uint16_t color)
+{
+    int w, h, stride, cw, ch, ox, oy;
+    uint8_t *fb = get_fb16(&w, &h, &stride);
+    if (!fb || rw <= 0 || rh <= 0) return;
+    if (!clip_blit(&x, &y, rw, rh, w, h, &cw, &ch, &ox, &oy)) return;
+    rgb_display_mark_dirty(x, y, cw, ch);
+
+    for (int row = y; row < y + ch; row++) {
+        fill16((uint16_t *)&fb[row * stride], x, x + cw, color);
+    }
+}
+
+void rgb_gfx_blit16(const uint16_t *data, int x, int y, int sw, int sh,
+                    int src_stride, int32_t transparent_color)
+{
+    int w, h, stride, cw, ch, ox, oy;
+    uint8_t *fb = get_fb16(&w, &h, &stride);
+    if (!fb || !data || sw <= 0 || sh <= 0) return;
+    if (!clip_blit(&x, &y, sw, sh, w, h, &cw, &ch, &ox, &oy)) return;
+    rgb_display_mark_dirty(x, y, cw, ch);
+
+    const uint16_t *src_row = &data[oy * src_stride + ox];
+    for (int row = 0; row < ch; row++) {
+        uint16_t *dst = (uint16_t *)&fb[(y + row) * stride] + x;
+        if (transparent_color < 0) {
+            memcpy(dst, src_row, cw * sizeof(uint16_t));
+        } else {
+            for (int i = 0; i < cw; i++) {
+                if (src_row[i] != (uint16_t)transparent_color) dst[i] = src_row[i];
+            }
+        }
+        src_row += src_stride;
+    }
+}
+
+// Scanline walker shared by the triangle rasterisers
+typedef struct {
+    edge_t e_long;      // v0 -> v2
+    edge_t e_short;     // v0 -> v1, then v1 -> v2
+    int x1, y1, x2, y2; // Middle and bottom vertex
+    int y, y_end;       // Visible scanline range
+    bool long_left;     // Long edge on the left side
+} tri_walk_t;
+
+static bool tri_begin(tri_walk_t *t, int x0, int y0, int x1, int y1, int x2, int y2, int h)
+{
+    // Sort vertices top to bottom
+    if (y1 < y0) { SWAP_INT(x0, x1); SWAP_INT(y0, y1); }
+    if (y2 < y1) { SWAP_INT(x1, x2); SWAP_INT(y1, y2); }
+    if (y1 < y0) { SWAP_INT(x0, x1); SWAP_INT(y0, y1); }
+
+    // Which side of the long edge (v0 -> v2) is the middle vertex on?
+    int64_t cross = (int64_t)(x2 - x0) * (y1 - y0) - (int64_t)(y2 - y0) * (x1 - x0);
+    if (cross == 0) return false;  // Degenerate (zero area)
+    t->long_left = cross < 0;
+
+    // Clip vertically once; edges start at the first visible scanline
+    t->y = y0 < 0 ? 0 : y0;
+    t->y_end = y2 > h ? h : y2;
+    if (t->y >= t->y_end) return false;
+
+    t->x1 = x1; t->y1 = y1;
+    t->x2 = x2; t->y2 = y2;
+    edge_init(&t->e_long, x0, y0, x2, y2, t->y);
+    if (t->y < y1) edge_init(&t->e_short, x0, y0, x1, y1, t->y);
+    else           edge_init(&t->e_short, x1, y1, x2, y2, t->y);
+    return true;
+}
+
+// Span [xl, xr) (16.16) of scanline y, then step the edges. Call for y = t->y .. t->y_end - 1.
+static inline void tri_next(tri_walk_t *t, int y, int32_t *xl, int32_t *xr)
+{
+    if (y == t->y1) edge_init(&t->e_short, t->x1, t->y1, t->x2, t->y2, y);
+
+    if (t->long_left) { *xl = t->e_long.x;  *xr = t->e_short.x; }
+    else              { *xl = t->e_short.x; *xr = t->e_long.x; }
+
+    t->e_long.x += t->e_long.dx;
+    t->e_short.x += t->e_short.dx;
+}
+
+// Mark the clipped rows of a triangle, across its full x extent
+static inline void tri_mark(const tri_walk_t *t, int x0, int x1, int x2)
+{
+    int lo = x0, hi = x0;
+    if (x1 < lo) lo = x1;
+    if (x1 > hi) hi = x1;
+    if (x2 < lo) lo = x2;
+    if (x2 > hi) hi = x2;
+    mark_box(lo, t->y, hi, t->y_end - 1);
+}
+
+void rgb_gfx_trifill(int x0, int y0, int x1, int y1, int x2, int y2, uint8_t color)
+{
+    int w, h, stride;
+    uint8_t *fb = get_fb(&w, &h, &stride);
+    tri_walk_t t;
+    if (!fb || !tri_begin(&t, x0, y0, x1, y1, x2, y2, h)) return;
+    tri_mark(&t, x0, x1, x2);
+
+    for (int y = t.y; y < t.y_end; y++) {
+        int32_t xl, xr;
+        tri_next(&t, y, &xl, &xr);
+        fill_span_fx(fb_row(fb, stride, y), w, xl, xr, color);
+    }
+}
+
+// Edge table entry for the general polygon filler
+typedef struct {
+    edge_t e;
+    int16_t y_top;     // First scanline crossed (already clipped to 0)
+    int16_t y_bottom;  // One past the last scanline crossed
+} poly_edge_t;
+
+// Static work area: keeps the (small) task stacks out of it
+static poly_edge_t s_poly_edges[RGB_GFX_POLY_MAX_POINTS];
+static uint8_t s_poly_active[RGB_GFX_POLY_MAX_POINTS];
+
+void rgb_gfx_polyfill(const rgb_gfx_point_t *pts, int n, uint8_t color)
+{
+    int w, h, stride;
+    uint8_t *fb = get_fb(&w, &h, &stride);
+    if (!fb || !pts || n < 3 || n > RGB_GFX_POLY_MAX_POINTS) return;
+
+    // Build the edge table, sorted by first scanline (insertion sort, n is small)
+    int num_edges = 0;
+    int y_min = h, y_max = 0;
+    int x_min = pts[0].x, x_max = pts[0].x;
+    for (int i = 0; i < n; i++) {
+        int xa = pts[i].x, ya = pts[i].y;
+        if (xa < x_min) x_min = xa;
+        if (xa > x_max) x_max = xa;
+        int xb = pts[(i + 1) % n].x, yb = pts[(i + 1) % n].y;
+        if (ya == yb) continue;  // Horizontal edges never cross a scanline centre
+        if (ya > yb) { SWAP_INT(xa, xb); SWAP_INT(ya, yb); }
+        if (yb <= 0 || ya >= h) continue;  // Entirely above or below the screen
+
+        int y_top = ya < 0 ? 0 : ya;
+        poly_edge_t pe;
+        edge_init(&pe.e, xa, ya, xb, yb, y_top);
+        pe.y_top = y_top;
+        pe.y_bottom = yb > h ? h : yb;
+
+        int j = num_edges++;
+        while (j > 0 && s_poly_edges[j - 1].y_top > pe.y_top) {
+            s_poly_edges[j] = s_poly_edges[j - 1];
+            j--;
+        }
+        s_poly_edges[j] = pe;
+
+        if (pe.y_top < y_min) y_min = pe.y_top;
+        if (pe.y_bottom > y_max) y_max = pe.y_bottom;
+    }
+
+    if (y_min < y_max) mark_box(x_min, y_min, x_max, y_max - 1);
+
+    int next_edge = 0;
+    int num_active = 0;
+    for (int y = y_min; y < y_max; y++) {
+        // Retire finished edges, advance the rest
+        int k = 0;
+        for (int i = 0; i < num_active; i++) {
+            poly_edge_t *pe = &s_poly_edges[s_poly_active[i]];
+            if (pe->y_bottom > y) s_poly_active[k++] = s_poly_active[i];
+        }
+        num_active = k;
+
+        // Activate edges starting on this scanline
+        while (next_edge < num_edges && s_poly_edges[next_edge].y_top == y) {
+            s_poly_active[num_active++] = next_edge++;
+        }
+
+        // Keep the active list sorted by x (nearly sorted already, so insertion sort)
+        for (int i = 1; i < num_active; i++) {
+            uint8_t idx = s_poly_active[i];
+            int32_t x = s_poly_edges[idx].e.x;
+            int j = i;
+            while (j > 0 && s_poly_edges[s_poly_active[j - 1]].e.x > x) {
+                s_poly_active[j] = s_poly_active[j - 1];
+                j--;
+            }
+            s_poly_active[j] = idx;
+        }
+
+        // Even-odd rule: fill between successive pairs of crossings
+        uint8_t *row = fb_row(fb, stride, y);
+        for (int i = 0; i + 1 < num_active; i += 2) {
+            fill_span_fx(row, w, s_poly_edges[s_poly_active[i]].e.x,
+                         s_poly_edges[s_poly_active[i + 1]].e.x, color);
+        }
+
+        for (int i = 0; i < num_active; i++) {
+            poly_edge_t *pe = &s_poly_edges[s_poly_active[i]];
+            pe->e.x += pe->e.dx;
+        }
+    }
+}
+
+// --- Lines ---
+
+// Cohen-Sutherland outcodes
+#define CS_LEFT   1
+#define CS_RIGHT  2
+#define CS_TOP    4
+#define CS_BOTTOM 8
+
+static inline int cs_outcode(int x, int y, int x_min, int y_min, int x_max, int y_max)
+{
+    int code = 0;
+    if (x < x_min) code |= CS_LEFT;
+    else if (x > x_max) code |= CS_RIGHT;
+    if (y < y_min) code |= CS_TOP;
+    else if (y > y_max) code |= CS_BOTTOM;
+    return code;
+}
+
+// Rounded a * b / c, for c != 0
+static inline int mul_div_round(int a, int b, int c)
+{
+    int64_t n = (int64_t)a * b;
+    if ((n < 0) != (c < 0)) return (int)((n - c / 2) / c);
+    return (int)((n + c / 2) / c);
+}
+
+// Offset along one axis to where a line crosses a clip edge: rounded a * b / c
+// with 0 < b / c <= 1. The whole quotient a / c is split off so the product
+// stays in range for any int endpoints.
+static inline int clip_offset(int64_t a, int64_t b, int64_t c)
+{
+    while (c > INT32_MAX || c < -INT32_MAX) {
+        b /= 2;
+        c /= 2;
+    }
+    return (int)(a / c * b + mul_div_round((int)(a % c), (int)b, (int)c));
+}
+
+// Clip a line segment to [x_min, x_max] x [y_min, y_max]; returns false if nothing is visible
+static bool clip_line(int *x0, int *y0, int *x1, int *y1, int x_min, int y_min, int x_max, int y_max)
+{
+    int c0 = cs_outcode(*x0, *y0, x_min, y_min, x_max, y_max);
+    int c1 = cs_outcode(*x1, *y1, x_min, y_min, x_max, y_max);
+
+    while (c0 | c1) {
+        if (c0 & c1) return false;  // Both ends on the same outside side
+
+        int c = c0 ? c0 : c1;
+        int64_t dx = (int64_t)*x1 - *x0, dy = (int64_t)*y1 - *y0;
+        int x, y;
+        if (c & (CS_TOP | CS_BOTTOM)) {
+            y = (c & CS_TOP) ? y_min : y_max;
+            x = *x0 + clip_offset(dx, (int64_t)y - *y0, dy);
+        } else {
+            x = (c & CS_LEFT) ? x_min : x_max;
+            y = *y0 + clip_offset(dy, (int64_t)x - *x0, dx);
+        }
+
+        if (c == c0) { *x0 = x; *y0 = y; c0 = cs_outcode(x, y, x_min, y_min, x_max, y_max); }
+        else         { *x1 = x; *y1 = y; c1 = cs_outcode(x, y, x_min, y_min, x_max, y_max); }
+    }
+    return true;
+}
+
+void rgb_gfx_line(int x0, int y0, int x1, int y1, uint8_t color)
+{
+    int w, h, stride;
+    uint8_t *fb = get_fb(&w, &h, &stride);
+    if (!fb || !clip_line(&x0, &y0, &x1, &y1, 0, 0, w - 1, h - 1)) return;
+    mark_box(x0 < x1 ? x0 : x1, y0 < y1 ? y0 : y1, x0 > x1 ? x0 : x1, y0 > y1 ? y0 : y1);
+
+    int dx = x1 > x0 ? x1 - x0 : x0 - x1;
+    int dy = y1 > y0 ? y1 - y0 : y0 - y1;
+
+    if (dx >= dy) {
+        // X-major: Bresenham emitting whole horizontal runs with memset
+        if (x0 > x1) { SWAP_INT(x0, x1); SWAP_INT(y0, y1); }
+        int step = y1 > y0 ? 1 : -1;
+        int y = y0;
+        uint8_t *row = fb_row(fb, stride, y);
+        int err = dx / 2;
+        int run_start = x0;
+        for (int x = x0; x < x1; x++) {
+            err -= dy;
+            if (err < 0) {
+                row_fill(row, run_start, x + 1, color);
+                y += step;
+                row = fb_row(fb, stride, y);
+                err += dx;
+                run_start = x + 1;
+            }
+        }
+        row_fill(row, run_start, x1 + 1, color);
+    } else {
+        // Y-major: one pixel per row
+        if (y0 > y1) { SWAP_INT(x0, x1); SWAP_INT(y0, y1); }
+        int step = x1 > x0 ? 1 : -1;
+        int x = x0;
+        int err = dy / 2;
+        for (int y = y0; y <= y1; y++) {
+            row_put(fb_row(fb, stride, y), x, color);
+            err -= dx;
+            if (err < 0) {
+                x += step;
+                err += dy;
+            }
+        }
+    }
+}
+
+// Integer square root (floor)
+static uint32_t isqrt32(uint32_t n)
+{
+    uint32_t root = 0, bit = 1u << 30;
+    while (bit > n) bit >>= 2;
+    while (bit) {
+        if (n >= root + bit) {
+            n -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+void rgb_gfx_line_thick(int x0, int y0, int x1, int y1, int thickness, uint8_t color)
+{
+    if (thickness <= 1) {
+        rgb_gfx_line(x0, y0, x1, y1, color);
+        return;
+    }
+    int w, h, stride;
+    if (!get_fb(&w, &h, &stride)) return;
+    if (thickness > 16384) thickness = 16384;  // Wider than any panel already
+
+    // Only the direction matters: halve long deltas until the squares fit
+    int64_t ldx = (int64_t)x1 - x0, ldy = (int64_t)y1 - y0;
+    while (ldx > 32767 || ldx < -32767 || ldy > 32767 || ldy < -32767) {
+        ldx /= 2;
+        ldy /= 2;
+    }
+    int dx = (int)ldx, dy = (int)ldy;
+    int len = (int)isqrt32((uint32_t)(dx * dx) + (uint32_t)(dy * dy));
+    if (len == 0) {
+        rgb_gfx_rectfill(x0 - thickness / 2, y0 - thickness / 2, thickness, thickness, color);
+        return;
+    }
+
+    // Offset to each side, perpendicular to the line
+    int ox = mul_div_round(-dy, thickness, 2 * len);
+    int oy = mul_div_round(dx, thickness, 2 * len);
+
+    // Clip the centre line to the framebuffer grown by more than the half-width:
+    // what is cut off can't reach the screen, and the corners fit rgb_gfx_point_t
+    int m = thickness / 2 + 1;
+    if (!clip_line(&x0, &y0, &x1, &y1, -m, -m, w - 1 + m, h - 1 + m)) return;
+
+    rgb_gfx_point_t quad[4] = {
+        { x0 + ox, y0 + oy }, { x1 + ox, y1 + oy },
+        { x1 - ox, y1 - oy }, { x0 - ox, y0 - oy },
+    };
+    rgb_gfx_polyfill(quad, 4, color);
+}
+
+void rgb_gfx_triangle(int x0, int y0, int x1, int y1, int x2, int y2, uint8_t color)
+{
+    rgb_gfx_line(x0, y0, x1, y1, color);
+    rgb_gfx_line(x1, y1, x2, y2, color);
+    rgb_gfx_line(x2, y2, x0, y0, color);
+}
+
+void rgb_gfx_polygon(const rgb_gfx_point_t *pts, int n, uint8_t color)
+{
+    if (!pts || n < 2) return;
+    for (int i = 0; i < n; i++) {
+        const rgb_gfx_point_t *a = &pts[i], *b = &pts[(i + 1) % n];
+        rgb_gfx_line(a->x, a->y, b->x, b->y, color);
+    }
+}
+
+// --- Circles, ellipses and arcs ---
+//
+// The midpoint ellipse generator yields the half-width of each row, from the
+// outermost row inwards. Filled shapes emit one span per row; outlines emit the
+// run joining a row to the next outer one, so every pixel goes out via memset.
+
+// sin() in Q14 for 0..90 degrees
+static const int16_t SIN_Q14[91] = {
+        0,   286,   572,   857,  1143,  1428,  1713,  1997,  2280,  2563,
+     2845,  3126,  3406,  3686,  3964,  4240,  4516,  4790,  5063,  5334,
+     5604,  5872,  6138,  6402,  6664,  6924,  7182,  7438,  7692,  7943,
+     8192,  8438,  8682,  8923,  9162,  9397,  9630,  9860, 10087, 10311,
+    10531, 10749, 10963, 11174, 11381, 11585, 11786, 11982, 12176, 12365,
+    12551, 12733, 12911, 13085, 13255, 13421, 13583, 13741, 13894, 14044,
+    14189, 14330, 14466, 14598, 14726, 14849, 14968, 15082, 15191, 15296,
+    15396, 15491, 15582, 15668, 15749, 15826, 15897, 15964, 16026, 16083,
+    16135, 16182, 16225, 16262, 16294, 16322, 16344, 16362, 16374, 16382,
+    16384,
+};
+
+static int32_t sin_q14(int deg)
+{
+    deg %= 360;
+    if (deg < 0) deg += 360;
+    if (deg < 90)  return SIN_Q14[deg];
+    if (deg < 180) return SIN_Q14[180 - deg];
+    if (deg < 270) return -SIN_Q14[deg - 180];
+    return -SIN_Q14[360 - deg];
+}
+
+static inline int32_t cos_q14(int deg)
+{
+    return sin_q14(deg + 90);
+}
+
+static inline int floor_div(int32_t n, int32_t d)  // d > 0
+{
+    return n >= 0 ? n / d : -((-n + d - 1) / d);
+}
+
+// Half-plane a * px <= b * py, evaluated per row
+typedef struct {
+    int32_t a, b;
+} half_plane_t;
+
+typedef struct {
+    uint8_t *fb;
+    int w, h, stride;
+    int cx, cy;
+    uint8_t color;
+    bool fill;
+    int prev_half_width;     // Outline mode: half-width of the next outer row
+    bool sector;             // Restrict output to an angular sector
+    bool sector_wide;        // Sweep > 180: union of the half-planes, else intersection
+    half_plane_t hp_start, hp_end;
+} ellipse_ctx_t;
+
+// Narrow [*lo, *hi] to the px where a * px <= b
+static inline void clip_half_plane(int32_t a, int32_t b, int *lo, int *hi)
+{
+    if (a > 0) {
+        int m = floor_div(b, a);
+        if (*hi > m) *hi = m;
+    } else if (a < 0) {
+        int m = -floor_div(b, -a);
+        if (*lo < m) *lo = m;
+    } else if (b < 0) {
+        *lo = 1; *hi = 0;
+    }
+}
+
+// Emit the run xa..xb (relative to the centre) on row offset py
+static void ellipse_run(const ellipse_ctx_t *c, int py, int xa, int xb)
+{
+    int y = c->cy + py;
+    if (y < 0 || y >= c->h) return;
+
+    if (!c->sector) {
+        fill_span(c->fb, c->stride, c->w, c->h, y, c->cx + xa, c->cx + xb, c->color);
+        return;
+    }
+
+    int lo_s = xa, hi_s = xb, lo_e = xa, hi_e = xb;
+    clip_half_plane(c->hp_start.a, c->hp_start.b * py, &lo_s, &hi_s);
+    clip_half_plane(c->hp_end.a, c->hp_end.b * py, &lo_e, &hi_e);
+
+    if (c->sector_wide) {
+        if (lo_s <= hi_s) fill_span(c->fb, c->stride, c->w, c->h, y, c->cx + lo_s, c->cx + hi_s, c->color);
+        if (lo_e <= hi_e) fill_span(c->fb, c->stride, c->w, c->h, y, c->cx + lo_e, c->cx + hi_e, c->color);
+    } else {
+        int lo = lo_s > lo_e ? lo_s : lo_e;
+        int hi = hi_s < hi_e ? hi_s : hi_e;
+        if (lo <= hi) fill_span(c->fb, c->stride, c->w, c->h, y, c->cx + lo, c->cx + hi, c->color);
+    }
+}
+
+static void ellipse_row(ellipse_ctx_t *c, int dy, int half_width)
+{
+    if (c->fill) {
+        ellipse_run(c, -dy, -half_width, half_width);
+        if (dy) ellipse_run(c, dy, -half_width, half_width);
+        return;
+    }
+
+    // Outline: cover the gap up to the next outer row's half-width
+    int inner = c->prev_half_width + 1;
+    if (inner > half_width) inner = half_width;
+    c->prev_half_width = half_width;
+
+    if (inner == 0) {
+        ellipse_run(c, -dy, -half_width, half_width);
+        if (dy) ellipse_run(c, dy, -half_width, half_width);
+    } else {
+        ellipse_run(c, -dy, -half_width, -inner);
+        ellipse_run(c, -dy, inner, half_width);
+        if (dy) {
+            ellipse_run(c, dy, -half_width, -inner);
+            ellipse_run(c, dy, inner, half_width);
+        }
+    }
+}
+
+// Midpoint ellipse, two regions; calls ellipse_row() for dy = ry .. 0
+static void ellipse_spans(ellipse_ctx_t *c, int rx, int ry)
+{
+    c->prev_half_width = -1;
+    if (ry == 0) {
+        ellipse_row(c, 0, rx);
+        return;
+    }
+
+    int64_t rx2 = (int64_t)rx * rx, ry2 = (int64_t)ry * ry;
+    int x = 0, y = ry;
+    int64_t px = 0, py = 2 * rx2 * y;
+
+    // Region 1: gentle slope, step x
+    int64_t p = ry2 - rx2 * ry + rx2 / 4;
+    while (px < py) {
+        x++;
+        px += 2 * ry2;
+        if (p < 0) {
+            p += ry2 + px;
+        } else {
+            ellipse_row(c, y, x - 1);
+            y--;
+            py -= 2 * rx2;
+            p += ry2 + px - py;
+        }
+    }
+
+    // Region 2: steep slope, step y
+    p = ry2 * ((int64_t)x * x + x) + ry2 / 4 + rx2 * (int64_t)(y - 1) * (y - 1) - rx2 * ry2;
+    for (;;) {
+        ellipse_row(c, y, x);
+        if (y == 0) break;
+        y--;
+        py -= 2 * rx2;
+        if (p > 0) {
+            p += rx2 - py;
+        } else {
+            x++;
+            px += 2 * ry2;
+            p += rx2 - py + px;
+        }
+    }
+}
+
+static bool ellipse_setup(ellipse_ctx_t *c, int cx, int cy, bool fill, uint8_t color)
+{
+    c->fb = get_fb(&c->w, &c->h, &c->stride);
+    if (!c->fb) return false;
+    c->cx = cx;
+    c->cy = cy;
+    c->fill = fill;
+    c->color = color;
+    c->sector = false;
+    return true;
+}
+
+// Angles in degrees, counter-clockwise from 3 o'clock. Returns false if the sweep is empty.
+static bool ellipse_set_sector(ellipse_ctx_t *c, int start_deg, int end_deg)
+{
+    int sweep = end_deg - start_deg;
+    if (sweep >= 360 || sweep <= -360) return true;  // Full turn
+    sweep = ((sweep % 360) + 360) % 360;
+    if (sweep == 0) return false;
+
+    // Screen y points down, so "counter-clockwise of start" is sin*px + cos*py <= 0
+    c->sector = true;
+    c->sector_wide = sweep > 180;
+    c->hp_start = (half_plane_t){ sin_q14(start_deg), -cos_q14(start_deg) };
+    c->hp_end = (half_plane_t){ -sin_q14(end_deg), cos_q14(end_deg) };
+    return true;
+}
+
+void rgb_gfx_circle(int cx, int cy, int r, uint8_t color)
+{
+    rgb_gfx_ellipse(cx, cy, r, r, color);
+}
+
+void rgb_gfx_circlefill(int cx, int cy, int r, uint8_t color)
+{
+    rgb_gfx_ellipsefill(cx, cy, r, r, color);
+}
+
+void rgb_gfx_ellipse(int cx, int cy, int rx, int ry, uint8_t color)
+{
+    ellipse_ctx_t c;
+    if (rx < 0 || ry < 0 || !ellipse_setup(&c, cx, cy, false, color)) return;
+    mark_box(cx - rx, cy - ry, cx + rx, cy + ry);
+    ellipse_spans(&c, rx, ry);
+}
+
+void rgb_gfx_ellipsefill(int cx, int cy, int rx, int ry, uint8_t color)
+{
+    ellipse_ctx_t c;
+    if (rx < 0 || ry < 0 || !ellipse_setup(&c, cx, cy, true, color)) return;
+    mark_box(cx - rx, cy - ry, cx + rx, cy + ry);
+    ellipse_spans(&c, rx, ry);
+}
+
+void rgb_gfx_arc(int cx, int cy, int r, int start_deg, int end_deg, uint8_t color)
+{
+    ellipse_ctx_t c;
+    if (r < 0 || !ellipse_setup(&c, cx, cy, false, color)) return;
+    if (!ellipse_set_sector(&c, start_deg, end_deg)) return;
+    mark_box(cx - r, cy - r, cx + r, cy + r);
+    ellipse_spans(&c, r, r);
+}
+
+void rgb_gfx_piefill(int cx, int cy, int r, int start_deg, int end_deg, uint8_t color)
+{
+    ellipse_ctx_t c;
+    if (r < 0 || !ellipse_setup(&c, cx, cy, true, color)) return;
+    if (!ellipse_set_sector(&c, start_deg, end_deg)) return;
+    mark_box(cx - r, cy - r, cx + r, cy + r);
+    ellipse_spans(&c, r, r);
+}
+
+// --- Texture-mapped triangles ---
+//
+// Affine mapping: u, v and z are linear in screen space, so their gradients are
+// constant over the triangle and computed once (the only divisions). Each span
+// starts from the plane equation and steps by the x gradient per pixel.
+
+typedef struct {
+    int32_t a0;           // Value at the reference vertex
+    int32_t dadx, dady;   // Gradients per pixel
+} gradient_t;
+
+// Plane through three vertex values; area2 is twice the signed screen area
+static void gradient_init(gradient_t *g, const rgb_gfx_vertex_t *v0, const rgb_gfx_vertex_t *v1,
+                          const rgb_gfx_vertex_t *v2, int32_t a0, int32_t a1, int32_t a2, int64_t area2)
+{
+    int64_t da1 = (int64_t)a1 - a0, da2 = (int64_t)a2 - a0;
+    g->a0 = a0;
+    g->dadx = (int32_t)((da1 * (v2->y - v0->y) - da2 * (v1->y - v0->y)) / area2);
+    g->dady = (int32_t)((da2 * (v1->x - v0->x) - da1 * (v2->x - v0->x)) / area2);
+}
+
+// Value at the centre of pixel (x, y), relative to the reference vertex
+static inline int32_t gradient_at(const gradient_t *g, int dx, int dy)
+{
+    return g->a0 + (int32_t)((int64_t)g->dadx * dx + (int64_t)g->dady * dy)
+         + (g->dadx + g->dady) / 2;
+}
+
+void rgb_gfx_zclear(uint16_t z)
+{
+    int w = rgb_display_get_fb_width();
+    int h = rgb_display_get_fb_height();
+    uint16_t *zb = rgb_display_get_zbuffer();
+    if (!zb) return;
+
+    // Buffer is 4-byte aligned: store pairs, then any odd last entry
+    uint32_t z2 = ((uint32_t)z << 16) | z;
+    uint32_t *p = (uint32_t *)zb;
+    for (int i = (w * h) / 2; i > 0; i--) *p++ = z2;
+    if ((w * h) & 1) zb[w * h - 1] = z;
+}
+
+void rgb_gfx_textri(const rgb_gfx_vertex_t *v0, const rgb_gfx_vertex_t *v1,
+                    const rgb_gfx_vertex_t *v2, const rgb_gfx_texture_t *tex, bool use_zbuffer)
+{
+    int w, h, stride;
+    uint8_t *fb = get_fb8(&w, &h, &stride);
+    tri_walk_t t;
+    if (!fb || !v0 || !v1 || !v2 || !tex || !tex->pixels) return;
+    if (!tri_begin(&t, v0->x, v0->y, v1->x, v1->y, v2->x, v2->y, h)) return;
+    tri_mark(&t, v0->x, v1->x, v2->x);
+
+    uint16_t *zb = use_zbuffer ? rgb_display_get_zbuffer() : NULL;
+
+    int64_t area2 = (int64_t)(v1->x - v0->x) * (v2->y - v0->y)
+                  - (int64_t)(v2->x - v0->x) * (v1->y - v0->y);
+    gradient_t gu, gv, gz;
+    gradient_init(&gu, v0, v1, v2, v0->u, v1->u, v2->u, area2);
+    gradient_init(&gv, v0, v1, v2, v0->v, v1->v, v2->v, area2);
+    // Depth carries 8 fractional bits
+    gradient_init(&gz, v0, v1, v2, (int32_t)v0->z << 8, (int32_t)v1->z << 8, (int32_t)v2->z << 8, area2);
+
+    const uint8_t *texels = tex->pixels;
+    int w_log2 = tex->w_log2;
+    uint32_t u_mask = (1u << w_log2) - 1;
+    uint32_t v_mask = (1u << tex->h_log2) - 1;
+    int transparent = tex->transparent;
+
+    for (int y = t.y; y < t.y_end; y++) {
+        int32_t xl, xr;
+        tri_next(&t, y, &xl, &xr);
+
+        int x = (xl + 0x7FFF) >> 16;
+        int x_end = (xr + 0x7FFF) >> 16;
+        if (x < 0) x = 0;
+        if (x_end > w) x_end = w;
+        if (x >= x_end) continue;
+
+        int dx = x - v0->x, dy = y - v0->y;
+        int32_t u = gradient_at(&gu, dx, dy);
+        int32_t v = gradient_at(&gv, dx, dy);
+        int32_t dudx = gu.dadx, dvdx = gv.dadx;
+
+        uint8_t *p = &fb[y * stride + x];
+        uint8_t *end = &fb[y * stride + x_end];
+
+        if (zb) {
+            int32_t z = gradient_at(&gz, dx, dy);
+            int32_t dzdx = gz.dadx;
+            uint16_t *zp = &zb[y * w + x];
+            for (; p < end; p++, zp++) {
+                uint16_t zv = (uint16_t)(z >> 8);
+                if (zv < *zp) {
+                    uint8_t c = texels[((((uint32_t)v >> 16) & v_mask) << w_log2) | (((uint32_t)u >> 16) & u_mask)];
+                    if (c != transparent) {
+                        *p = c;
+                        *zp = zv;
+                    }
+                }
+                u += dudx; v += dvdx; z += dzdx;
+            }
+        } else if (transparent >= 0) {
+            for (; p < end; p++) {
+                uint8_t c = texels[((((uint32_t)v >> 16) & v_mask) << w_log2) | (((uint32_t)u >> 16) & u_mask)];
+                if (c != transparent) *p = c;
+                u += dudx; v += dvdx;
+            }
+        } else {
+            for (; p < end; p++) {
+                *p = texels[((((uint32_t)v >> 16) & v_mask) << w_log2) | (((uint32_t)u >> 16) & u_mask)];
+                u += dudx; v += dvdx;
+            }
+        }
+    }
+}
+
+// --- Palette lookup tables ---
+//
+// Table builders map RGB results back to the current VGA palette with a
+// nearest-colour search over entries sorted by green (the heaviest weighted
+// channel), scanning outwards until the green distance alone exceeds the best match.
+
+typedef struct {
+    uint8_t r, g, b, index;
+} pal_entry_t;
+
+// Work area (static, to keep it off the task stack)
+static pal_entry_t s_pal_sorted[256];
+static uint8_t s_pal_green_start[256];  // First sorted entry with green >= value
+
+#define DIST_WR 3
+#define DIST_WG 4
+#define DIST_WB 2
+
+static inline void rgb565_to_rgb888(uint16_t c, int *r, int *g, int *b)
+{
+    int r5 = (c >> 11) & 0x1F, g6 = (c >> 5) & 0x3F, b5 = c & 0x1F;
+    *r = (r5 << 3) | (r5 >> 2);
+    *g = (g6 << 2) | (g6 >> 4);
+    *b = (b5 << 3) | (b5 >> 2);
+}
+
+// Snapshot the VGA palette into the search structure
+static void pal_search_init(void)
+{
+    int n = 0;
+    for (int i = 0; i < 256; i++) {
+        int r, g, b;
+        rgb565_to_rgb888(rgb_display_get_vga_palette_entry(i), &r, &g, &b);
+        pal_entry_t e = { (uint8_t)r, (uint8_t)g, (uint8_t)b, (uint8_t)i };
+
+        int j = n++;
+        while (j > 0 && s_pal_sorted[j - 1].g > e.g) {
+            s_pal_sorted[j] = s_pal_sorted[j - 1];
+            j--;
+        }
+        s_pal_sorted[j] = e;
+    }
+
+    int k = 0;
+    for (int g = 0; g < 256; g++) {
+        while (k < 255 && s_pal_sorted[k].g < g) k++;
+        s_pal_green_start[g] = k;
+    }
+}
+
+static uint8_t pal_nearest(int r, int g, int b)
+{
+    int start = s_pal_green_start[g];
+    int best = 0x7FFFFFFF;
+    uint8_t best_index = 0;
+
+    for (int i = start; i < 256; i++) {
+        const pal_entry_t *e = &s_pal_sorted[i];
+        int dg = e->g - g;
+        if (DIST_WG * dg * dg >= best) break;
+        int dr = e->r - r, db = e->b - b;
+        int d = DIST_WR * dr * dr + DIST_WG * dg * dg + DIST_WB * db * db;
+        if (d < best) { best = d; best_index = e->index; }
+    }
+    for (int i = start - 1; i >= 0; i--) {
+        const pal_entry_t *e = &s_pal_sorted[i];
+        int dg = e->g - g;
+        if (DIST_WG * dg * dg >= best) break;
+        int dr = e->r - r, db = e->b - b;
+        int d = DIST_WR * dr * dr + DIST_WG * dg * dg + DIST_WB * db * db;
+        if (d < best) { best = d; best_index = e->index; }
+    }
+    return best_index;
+}
+
+static inline int blend_channel(rgb_gfx_blend_t mode, int s, int d)
+{
+    switch (mode) {
+    case RGB_GFX_BLEND_ADD:      return s + d > 255 ? 255 : s + d;
+    case RGB_GFX_BLEND_MULTIPLY: return (s * d + 127) / 255;
+    case RGB_GFX_BLEND_HALF:
+    default:                     return (s + d) / 2;
+    }
+}
+
+void rgb_gfx_build_blend_table(uint8_t *table, rgb_gfx_blend_t mode)
+{
+    if (!table) return;
+    pal_search_init();
+
+    int r[256], g[256], b[256];
+    for (int i = 0; i < 256; i++) {
+        rgb565_to_rgb888(rgb_display_get_vga_palette_entry(i), &r[i], &g[i], &b[i]);
+    }
+
+    // All supported modes are symmetric: search one half, mirror the other
+    for (int s = 0; s < 256; s++) {
+        for (int d = s; d < 256; d++) {
+            uint8_t c = pal_nearest(blend_channel(mode, r[s], r[d]),
+                                    blend_channel(mode, g[s], g[d]),
+                                    blend_channel(mode, b[s], b[d]));
+            table[(s << 8) | d] = c;
+            table[(d << 8) | s] = c;
+        }
+    }
+}
+
+uint8_t *rgb_gfx_create_blend_table(rgb_gfx_blend_t mode, bool prefer_psram)
+{
+    uint8_t *table = NULL;
+
+#ifdef CONFIG_SPIRAM
+    if (prefer_psram) {
+        table = heap_caps_malloc(RGB_GFX_BLEND_TABLE_SIZE, MALLOC_CAP_SPIRAM);
+    }
+#endif
+    if (!table) {
+        // Internal RAM: random lookups per pixel are much faster here
+        table = heap_caps_malloc(RGB_GFX_BLEND_TABLE_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+#ifdef CONFIG_SPIRAM
+    if (!table) {
+        table = heap_caps_malloc(RGB_GFX_BLEND_TABLE_SIZE, MALLOC_CAP_SPIRAM);
+    }
+#endif
+    if (table) rgb_gfx_build_blend_table(table, mode);
+    return table;
+}
+
+void rgb_gfx_free_blend_table(uint8_t *table)
+{
+    heap_caps_free(table);
+}
+
+void rgb_gfx_blit_blend(const uint8_t *data, int x, int y, int sw, int sh,
+                        int src_stride, int transparent_color, const uint8_t *table)
+{
+    int w, h, stride, cw, ch, ox, oy;
+    uint8_t *fb = get_fb8(&w, &h, &stride);
+    if (!fb || !data || !table || sw <= 0 || sh <= 0) return;
+    if (!clip_blit(&x, &y, sw, sh, w, h, &cw, &ch, &ox, &oy)) return;
+    rgb_display_mark_dirty(x, y, cw, ch);
+
+    const uint8_t *src_row = &data[oy * src_stride + ox];
+    uint8_t *dst_row = &fb[y * stride + x];
+    int key = transparent_color < 0 ? -1 : (uint8_t)transparent_color;
+
+    for (int row = 0; row < ch; row++) {
+        for (int i = 0; i < cw; i++) {
+            uint8_t pixel = src_row[i];
+            if (pixel != key) dst_row[i] = table[(pixel << 8) | dst_row[i]];
+        }
+        src_row += src_stride;
+        dst_row += stride;
+    }
+}
+
+void rgb_gfx_rectfill_blend(int x, int y, int rw, int rh, uint8_t color, const uint8_t *table)
+{
+    int w, h, stride, cw, ch, ox, oy;
+    uint8_t *fb = get_fb8(&w, &h, &stride);
+    if (!fb || !table || rw <= 0 || rh <= 0) return;
+    if (!clip_blit(&x, &y, rw, rh, w, h, &cw, &ch, &ox, &oy)) return;
+    rgb_display_mark_dirty(x, y, cw, ch);
+
+    // The source colour is fixed, so only one 256-byte row of the table is used
+    const uint8_t *lut = &table[color << 8];
+    uint8_t *dst_row = &fb[y * stride + x];
+    for (int row = 0; row < ch; row++) {
+        for (int i = 0; i < cw; i++) {
+            dst_row[i] = lut[dst_row[i]];
+        }
+        dst_row += stride;
+    }
+}
+
+void rgb_gfx_build_colormaps(uint8_t *maps, int levels)
+{
+    if (!maps || levels <= 0) return;
+    pal_search_init();
+
+    for (int c = 0; c < 256; c++) maps[c] = c;  // Level 0: full brightness
+
+    for (int level = 1; level < levels; level++) {
+        // Linear fade to black at the last level
+        int scale = 256 * (levels - 1 - level) / (levels - 1);
+        uint8_t *map = &maps[level * 256];
+        for (int c = 0; c < 256; c++) {
+            int r, g, b;
+            rgb565_to_rgb888(rgb_display_get_vga_palette_entry(c), &r, &g, &b);
+            map[c] = pal_nearest((r * scale) >> 8, (g * scale) >> 8, (b * scale) >> 8);
+        }
+    }
+}
+
+void rgb_gfx_blit_remap(const uint8_t *data, int x, int y, int sw, int sh,
+                        int src_stride, int transparent_color, const uint8_t *remap)
+{
+    int w, h, stride, cw, ch, ox, oy;
+    uint8_t *fb = get_fb8(&w, &h, &stride);
+    if (!fb || !data || !remap || sw <= 0 || sh <= 0) return;
+    if (!clip_blit(&x, &y, sw, sh, w, h, &cw, &ch, &ox, &oy)) return;
+    rgb_display_mark_dirty(x, y, cw, ch);
+
+    const uint8_t *src_row = &data[oy * src_stride + ox];
+    uint8_t *dst_row = &fb[y * stride + x];
+
+    if (transparent_color < 0) {
+        for (int row = 0; row < ch; row++) {
+            for (int i = 0; i < cw; i++) {
+                dst_row[i] = remap[src_row[i]];
             }
+            src_row += src_stride;
+            dst_row += stride;
         }
+        return;
     }
-}
\ No newline at end of file
+
+    uint8_t key = (uint8_t)transparent_color;
+    for (int row = 0; row < ch; row++) {
+        for (int i = 0; i < cw; i++) {
+            uint8_t pixel = src_row[i];
+            if (pixel != key) dst_row[i] = remap[pixel];
+        }
+        src_row += src_stride;
+        dst_row += stride;
+    }
+}
+
+void rgb_gfx_rectfill_remap(int x, int y, int rw, int rh, const uint8_t *remap)
+{
+    int w, h, stride, cw, ch, ox, oy;
+    uint8_t *fb = get_fb8(&w, &h, &stride);
+    if (!fb || !remap || rw <= 0 || rh <= 0) return;
+    if (!clip_blit(&x, &y, rw, rh, w, h, &cw, &ch, &ox, &oy)) return;
+    rgb_display_mark_dirty(x, y, cw, ch);
+
+    uint8_t *dst_row = &fb[y * stride + x];
+    for (int row = 0; row < ch; row++) {
+        for (int i = 0; i < cw; i++) {
+            dst_row[i] = remap[dst_row[i]];
+        }
+        dst_row += stride;
+    }
+}
+
+// --- Scaled and rotated blits ---
+//
+// Both use inverse mapping: each destination pixel centre is mapped back into
+// the sprite with 16.16 coordinates that step by a constant per pixel.
+
+void rgb_gfx_blit_scaled(const uint8_t *data, int x, int y, int sw, int sh,
+                         int src_stride, int transparent_color,
+                         int32_t scale_x, int32_t scale_y)
+{
+    int w, h, stride, cw, ch, ox, oy;
+    uint8_t *fb = get_fb8(&w, &h, &stride);
+    if (!fb || !data || sw <= 0 || sh <= 0 || scale_x <= 0 || scale_y <= 0) return;
+
+    // Destination size, then source step per destination pixel
+    int dw = (int)(((int64_t)sw * scale_x + 0x8000) >> 16);
+    int dh = (int)(((int64_t)sh * scale_y + 0x8000) >> 16);
+    if (dw <= 0 || dh <= 0) return;
+    int32_t step_x = (int32_t)(((int64_t)sw << 16) / dw);
+    int32_t step_y = (int32_t)(((int64_t)sh << 16) / dh);
+
+    if (!clip_blit(&x, &y, dw, dh, w, h, &cw, &ch, &ox, &oy)) return;
+    rgb_display_mark_dirty(x, y, cw, ch);
+
+    int32_t u0 = ox * step_x + step_x / 2;
+    int32_t v = oy * step_y + step_y / 2;
+    uint8_t *dst_row = &fb[y * stride + x];
+    int key = transparent_color < 0 ? -1 : (uint8_t)transparent_color;
+
+    for (int row = 0; row < ch; row++) {
+        const uint8_t *src_row = &data[(v >> 16) * src_stride];
+        int32_t u = u0;
+        if (key < 0) {
+            for (int i = 0; i < cw; i++) {
+                dst_row[i] = src_row[u >> 16];
+                u += step_x;
+            }
+        } else {
+            for (int i = 0; i < cw; i++) {
+                uint8_t pixel = src_row[u >> 16];
+                if (pixel != key) dst_row[i] = pixel;
+                u += step_x;
+            }
+        }
+        v += step_y;
+        dst_row += stride;
+    }
+}
+
+static inline int64_t floor_div64(int64_t n, int64_t d)  // d > 0
+{
+    return n >= 0 ? n / d : -((-n + d - 1) / d);
+}
+
+// Narrow [*k0, *k1) to the k where 0 <= a + b * k < len
+static void span_limit(int64_t a, int64_t b, int64_t len, int *k0, int *k1)
+{
+    int64_t lo, hi;  // Inclusive
+    if (b > 0) {
+        lo = -floor_div64(a, b);                  // ceil(-a / b)
+        hi = floor_div64(len - 1 - a, b);
+    } else if (b < 0) {
+        lo = -floor_div64(len - 1 - a, -b);       // ceil((a - len + 1) / -b)
+        hi = floor_div64(a, -b);
+    } else {
+        if (a < 0 || a >= len) *k1 = *k0;
+        return;
+    }
+    if (lo > *k0) *k0 = lo < *k1 ? (int)lo : *k1;
+    if (hi + 1 < *k1) *k1 = hi + 1 > *k0 ? (int)(hi + 1) : *k0;
+}
+
+void rgb_gfx_blit_rotated(const uint8_t *data, int sw, int sh, int src_stride,
+                          int transparent_color, int pivot_x, int pivot_y,
+                          int x, int y, int angle_deg, int32_t scale)
+{
+    int w, h, stride;
+    uint8_t *fb = get_fb8(&w, &h, &stride);
+    if (!fb || !data || sw <= 0 || sh <= 0 || scale <= 0) return;
+
+    int32_t c = cos_q14(angle_deg), s = sin_q14(angle_deg);
+
+    // Destination bounding box: forward-map the corners (y points down, so
+    // a counter-clockwise turn is x' = x*c + y*s, y' = -x*s + y*c)
+    int bx0 = w, by0 = h, bx1 = -1, by1 = -1;
+    for (int i = 0; i < 4; i++) {
+        int64_t cx = ((i & 1) ? sw : 0) - pivot_x;
+        int64_t cy = ((i & 2) ? sh : 0) - pivot_y;
+        int64_t fx = ((cx * c + cy * s) * scale) >> 30;   // Q14 * 16.16
+        int64_t fy = ((-cx * s + cy * c) * scale) >> 30;
+        int px = x + (int)fx, py = y + (int)fy;
+        if (px < bx0) bx0 = px;
+        if (px + 1 > bx1) bx1 = px + 1;
+        if (py < by0) by0 = py;
+        if (py + 1 > by1) by1 = py + 1;
+    }
+    if (bx0 < 0) bx0 = 0;
+    if (by0 < 0) by0 = 0;
+    if (bx1 > w) bx1 = w;
+    if (by1 > h) by1 = h;
+    if (bx0 >= bx1 || by0 >= by1) return;
+    rgb_display_mark_dirty(bx0, by0, bx1 - bx0, by1 - by0);
+
+    // Inverse mapping gradients (16.16 source texels per destination pixel)
+    int64_t dudx = ((int64_t)c << 18) / scale;
+    int64_t dvdx = ((int64_t)s << 18) / scale;
+    int64_t dudy = -dvdx;
+    int64_t dvdy = dudx;
+
+    // Source coordinates at the centre of the box's top-left pixel (relative to (x, y))
+    int64_t rx = 2 * (bx0 - x) + 1, ry = 2 * (by0 - y) + 1;   // Doubled, for the half pixel
+    int64_t u_row = ((int64_t)pivot_x << 16) + (dudx * rx + dudy * ry) / 2;
+    int64_t v_row = ((int64_t)pivot_y << 16) + (dvdx * rx + dvdy * ry) / 2;
+
+    int key = transparent_color < 0 ? -1 : (uint8_t)transparent_color;
+    int64_t u_len = (int64_t)sw << 16, v_len = (int64_t)sh << 16;
+
+    for (int yy = by0; yy < by1; yy++) {
+        // Clip the row to where it actually crosses the sprite
+        int k0 = 0, k1 = bx1 - bx0;
+        span_limit(u_row, dudx, u_len, &k0, &k1);
+        span_limit(v_row, dvdx, v_len, &k0, &k1);
+
+        if (k0 < k1) {
+            int32_t u = (int32_t)(u_row + dudx * k0);
+            int32_t v = (int32_t)(v_row + dvdx * k0);
+            int32_t du = (int32_t)dudx, dv = (int32_t)dvdx;
+            uint8_t *dst = &fb[yy * stride + bx0 + k0];
+            for (int k = k0; k < k1; k++) {
+                uint8_t pixel = data[(v >> 16) * src_stride + (u >> 16)];
+                if (pixel != key) *dst = pixel;
+                dst++;
+                u += du;
+                v += dv;
+            }
+        }
+
+        u_row += dudy;
+        v_row += dvdy;
+    }
+}
+
+// --- Flood fill ---
+//
+// Span-based seed fill (Heckbert's algorithm): each stack entry is a run of a
+// parent row whose neighbours on the next row still need exploring. The stack
+// lives in a caller-sized arena, so a fill never recurses or allocates.
+
+typedef struct {
+    int16_t y, xl, xr, dy;
+} fill_segment_t;
+
+_Static_assert(sizeof(fill_segment_t) == RGB_GFX_FILL_SEGMENT_SIZE, "fill segment size");
+
+#define FILL_DEFAULT_SEGMENTS 128
+static fill_segment_t s_fill_default_arena[FILL_DEFAULT_SEGMENTS];
+static fill_segment_t *s_fill_arena = s_fill_default_arena;
+static int s_fill_arena_len = FILL_DEFAULT_SEGMENTS;
+
+void rgb_gfx_set_fill_arena(void *buf, size_t size)
+{
+    if (buf && size >= sizeof(fill_segment_t)) {
+        s_fill_arena = (fill_segment_t *)buf;
+        s_fill_arena_len = size / sizeof(fill_segment_t);
+    } else {
+        s_fill_arena = s_fill_default_arena;
+        s_fill_arena_len = FILL_DEFAULT_SEGMENTS;
+    }
+}
+
+typedef struct {
+    bool border;      // Border fill: stop at `value`; flood fill: replace `value`
+    uint8_t value;
+    uint8_t color;
+} fill_rule_t;
+
+static inline bool fill_inside(const fill_rule_t *r, uint8_t p)
+{
+    return r->border ? (p != r->value && p != r->color) : p == r->value;
+}
+
+static int seed_fill(int x, int y, const fill_rule_t *r)
+{
+    int w, h, stride;
+    uint8_t *fb = get_fb(&w, &h, &stride);
+    if (!fb || s_bpp == 16 || x < 0 || x >= w || y < 0 || y >= h) return 0;
+    if (!fill_inside(r, row_get(fb_row(fb, stride, y), x))) return 0;
+
+    fill_segment_t *stack = s_fill_arena;
+    int sp = 0;
+    bool overflow = false;
+    int bx0 = x, by0 = y, bx1 = x, by1 = y;  // Filled area, for the dirty map
+
+#define FILL_PUSH(Y, XL, XR, DY) do { \
+        if ((Y) + (DY) >= 0 && (Y) + (DY) < h) { \
+            if (sp < s_fill_arena_len) stack[sp++] = (fill_segment_t){ (Y), (XL), (XR), (DY) }; \
+            else overflow = true; \
+        } \
+    } while (0)
+
+    FILL_PUSH(y, x, x, 1);
+    FILL_PUSH(y + 1, x, x, -1);  // Seed segment, popped first
+
+    while (sp > 0) {
+        fill_segment_t seg = stack[--sp];
+        int dy = seg.dy;
+        int x1 = seg.xl, x2 = seg.xr;
+        y = seg.y + dy;
+        uint8_t *row = fb_row(fb, stride, y);
+        if (y < by0) by0 = y;
+        if (y > by1) by1 = y;
+
+        // Extend left from x1
+        x = x1;
+        while (x >= 0 && fill_inside(r, row_get(row, x))) x--;
+        int l;
+        if (x < x1) {
+            l = x + 1;
+            row_fill(row, l, x1 + 1, r->color);
+            if (l < bx0) bx0 = l;
+            if (l < x1) FILL_PUSH(y, l, x1 - 1, -dy);  // Leak on the left
+            x = x1 + 1;
+        } else {
+            // x1 is outside: skip to the next inside pixel within the parent span
+            x = x1 + 1;
+            while (x <= x2 && !fill_inside(r, row_get(row, x))) x++;
+            if (x > x2) continue;
+            l = x;
+        }
+
+        do {
+            // Run to the right
+            int run = x;
+            while (x < w && fill_inside(r, row_get(row, x))) x++;
+            if (x > run) row_fill(row, run, x, r->color);
+            if (x - 1 > bx1) bx1 = x - 1;
+
+            FILL_PUSH(y, l, x - 1, dy);
+            if (x > x2 + 1) FILL_PUSH(y, x2 + 1, x - 1, -dy);  // Leak on the right
+
+            // Skip to the next inside pixel within the parent span
+            x++;
+            while (x <= x2 && !fill_inside(r, row_get(row, x))) x++;
+            l = x;
+        } while (x <= x2);
+    }
+#undef FILL_PUSH
+
+    mark_box(bx0, by0, bx1, by1);
+    return overflow ? -1 : 0;
+}
+
+int rgb_gfx_floodfill(int x, int y, uint8_t color)
+{
+    int w, h, stride;
+    uint8_t *fb = get_fb(&w, &h, &stride);
+    if (!fb || s_bpp == 16 || x < 0 || x >= w || y < 0 || y >= h) return 0;
+
+    color &= color_mask();  // As stored, so filled pixels no longer read back as inside
+    fill_rule_t r = { false, row_get(fb_row(fb, stride, y), x), color };
+    if (r.value == color) return 0;  // Nothing to do
+    return seed_fill(x, y, &r);
+}
+
+int rgb_gfx_borderfill(int x, int y, uint8_t border, uint8_t color)
+{
+    int w, h, stride;
+    if (!get_fb(&w, &h, &stride)) return 0;
+    fill_rule_t r = { true, border & color_mask(), color & color_mask() };
+    return seed_fill(x, y, &r);
+}
+
+// --- Pattern and gradient fills ---
+//
+// Each pattern row is expanded once into 8 pixel colours; spans are then stored
+// as aligned 32-bit words (two alternating words per row) with byte head/tail.
+// Patterns are anchored to screen coordinates, so adjacent fills tile seamlessly.
+
+static const uint8_t BAYER8[8][8] = {
+    {  0, 32,  8, 40,  2, 34, 10, 42 },
+    { 48, 16, 56, 24, 50, 18, 58, 26 },
+    { 12, 44,  4, 36, 14, 46,  6, 38 },
+    { 60, 28, 52, 20, 62, 30, 54, 22 },
+    {  3, 35, 11, 43,  1, 33,  9, 41 },
+    { 51, 19, 59, 27, 49, 17, 57, 25 },
+    { 15, 47,  7, 39, 13, 45,  5, 37 },
+    { 63, 31, 55, 23, 61, 29, 53, 21 },
+};
+
+// Store n pixels starting at screen column x, colour of column c = row8[c & 7]
+static void pattern_span(uint8_t *dst, int x, int n, const uint8_t *row8)
+{
+    while (n > 0 && ((uintptr_t)dst & 3)) {
+        *dst++ = row8[x & 7];
+        x++;
+        n--;
+    }
+
+    int words = n >> 2;
+    if (words) {
+        // Little-endian: the lowest address takes the lowest byte
+        uint32_t w0 = row8[x & 7] | (row8[(x + 1) & 7] << 8) |
+                      (row8[(x + 2) & 7] << 16) | ((uint32_t)row8[(x + 3) & 7] << 24);
+        uint32_t w1 = row8[(x + 4) & 7] | (row8[(x + 5) & 7] << 8) |
+                      (row8[(x + 6) & 7] << 16) | ((uint32_t)row8[(x + 7) & 7] << 24);
+        uint32_t *d = (uint32_t *)dst;
+        int i = 0;
+        for (; i + 1 < words; i += 2) {
+            d[i] = w0;
+            d[i + 1] = w1;
+        }
+        if (i < words) d[i] = w0;
+
+        dst += words * 4;
+        x += words * 4;
+        n &= 3;
+    }
+
+    while (n-- > 0) {
+        *dst++ = row8[x & 7];
+        x++;
+    }
+}
+
+// Pixels [x0, x1) of a packed row, colour of column c = row8[c & 7]. The 8
+// pixels pack into s_bpp bytes, built once; whole bytes are stored a word at
+// a time, and the partial bytes at either end merged as in packed_fill().
+static void packed_pattern_span(uint8_t *row, int x0, int x1, const uint8_t *row8)
+{
+    int ppb = 8 / s_bpp;  // Pixels per byte
+    int period = s_bpp - 1;  // Byte b holds pattern columns (b & period) * ppb onwards
+    uint8_t pix = (1 << s_bpp) - 1;
+    uint8_t bytes[4];
+    for (int j = 0; j <= period; j++) {
+        uint8_t v = 0;
+        for (int p = 0; p < ppb; p++) v = (v << s_bpp) | (row8[j * ppb + p] & pix);
+        bytes[j] = v;
+    }
+
+    int b0 = x0 / ppb, b1 = x1 / ppb;
+    uint8_t head = 0xFF >> ((x0 % ppb) * s_bpp);           // Pixels from x0 in byte b0
+    uint8_t tail = ~(0xFF >> ((x1 % ppb) * s_bpp));        // Pixels before x1 in byte b1
+
+    if (b0 == b1) {
+        uint8_t m = head & tail;
+        row[b0] = (row[b0] & ~m) | (bytes[b0 & period] & m);
+        return;
+    }
+    row[b0] = (row[b0] & ~head) | (bytes[b0 & period] & head);
+    int b = b0 + 1;
+    while (b < b1 && ((uintptr_t)(row + b) & 3)) {
+        row[b] = bytes[b & period];
+        b++;
+    }
+    if (b + 4 <= b1) {
+        // The pattern period (1, 2 or 4 bytes) divides a word; little-endian
+        uint32_t word = bytes[b & period] | (bytes[(b + 1) & period] << 8) |
+                        (bytes[(b + 2) & period] << 16) | ((uint32_t)bytes[(b + 3) & period] << 24);
+        uint32_t *d = (uint32_t *)(row + b);
+        for (; b + 4 <= b1; b += 4) *d++ = word;
+    }
+    for (; b < b1; b++) row[b] = bytes[b & period];
+    if (tail) row[b1] = (row[b1] & ~tail) | (bytes[b1 & period] & tail);
+}
+
+void rgb_gfx_rectfill_pattern(int x, int y, int rw, int rh, const uint8_t pattern[8],
+                              uint8_t fg, uint8_t bg)
+{
+    int w, h, stride, cw, ch, ox, oy;
+    uint8_t *fb = get_fb(&w, &h, &stride);
+    if (!fb || !pattern || rw <= 0 || rh <= 0) return;
+    if (!clip_blit(&x, &y, rw, rh, w, h, &cw, &ch, &ox, &oy)) return;
+    rgb_display_mark_dirty(x, y, cw, ch);
+
+    // Expand each pattern row to 8 pixel colours once
+    uint8_t rows[8][8];
+    for (int r = 0; r < 8; r++) {
+        for (int c = 0; c < 8; c++) {
+            rows[r][c] = (pattern[r] & (0x80 >> c)) ? fg : bg;
+        }
+    }
+
+    if (s_bpp == 16) {
+        for (int row = 0; row < ch; row++) {
+            uint8_t *dst = fb_row(fb, stride, y + row);
+            const uint8_t *row8 = rows[(y + row) & 7];
+            for (int i = x; i < x + cw; i++) row_put(dst, i, row8[i & 7]);
+        }
+        return;
+    }
+    if (s_bpp != 8) {
+        for (int row = 0; row < ch; row++) {
+            packed_pattern_span(fb_row(fb, stride, y + row), x, x + cw, rows[(y + row) & 7]);
+        }
+        return;
+    }
+
+    uint8_t *dst_row = &fb[y * stride + x];
+    for (int row = 0; row < ch; row++) {
+        pattern_span(dst_row, x, cw, rows[(y + row) & 7]);
+        dst_row += stride;
+    }
+}
+
+void rgb_gfx_rectfill_gradient(int x, int y, int rw, int rh, uint8_t c0, uint8_t c1, bool vertical)
+{
+    int w, h, stride, cw, ch, ox, oy;
+    uint8_t *fb = get_fb8(&w, &h, &stride);
+    if (!fb || rw <= 0 || rh <= 0) return;
+    if (!clip_blit(&x, &y, rw, rh, w, h, &cw, &ch, &ox, &oy)) return;
+    rgb_display_mark_dirty(x, y, cw, ch);
+
+    int steps = c1 >= c0 ? c1 - c0 : c0 - c1;
+    int dir = c1 >= c0 ? 1 : -1;
+    int span = (vertical ? rh : rw) - 1;
+    if (span < 1) span = 1;
+
+    uint8_t *dst_row = &fb[y * stride + x];
+
+    if (vertical) {
+        // Constant level per row: one dithered 8-pixel pattern per row
+        for (int row = 0; row < ch; row++) {
+            int level = (oy + row) * steps * 64 / span;   // 6 fractional bits
+            const uint8_t *bayer = BAYER8[(y + row) & 7];
+            uint8_t row8[8];
+            for (int c = 0; c < 8; c++) {
+                row8[c] = c0 + dir * ((level + bayer[c]) >> 6);
+            }
+            pattern_span(dst_row, x, cw, row8);
+            dst_row += stride;
+        }
+        return;
+    }
+
+    // Horizontal: rows repeat every 8 (the Bayer period), so dither the first
+    // 8 rows and copy the rest from 8 rows above. The level steps by a 16.16
+    // increment per column instead of a divide per pixel.
+    int32_t level_step = (int32_t)((((int64_t)steps * 64 << 16) + span - 1) / span);  // Up: c1 is reached
+    int32_t level_start = (int32_t)(((int64_t)ox * steps * 64 << 16) / span);
+    for (int row = 0; row < ch; row++) {
+        if (row >= 8) {
+            memcpy(dst_row, dst_row - 8 * stride, cw);
+        } else {
+            const uint8_t *bayer = BAYER8[(y + row) & 7];
+            int32_t level = level_start;
+            for (int i = 0; i < cw; i++) {
+                dst_row[i] = c0 + dir * (((level >> 16) + bayer[(x + i) & 7]) >> 6);
+                level += level_step;
+            }
+        }
+        dst_row += stride;
+    }
+}
@@ -0,0 +1,290 @@
+/*
+ * rgb_gfx_sprite.c - Software sprite manager with save-under
+ *
+ * Each frame only sprites that changed, plus sprites overlapping the area they
+ * touched, are restored and redrawn. All pixel traffic goes through rgb_gfx blits.
+ *
+ * Collision masks turn each sprite row into a 64-bit opacity word once, so an
+ * overlap test is a shift and an AND per shared row.
+ */
+
+#include "rgb_gfx.h"
+#include "rgb_display.h"
+#include <string.h>
+
+typedef struct {
+    int16_t x0, y0, x1, y1;  // Half-open
+} rect_t;
+
+// Work areas (static, to keep them off the task stack)
+static uint8_t s_order[RGB_GFX_MAX_SPRITES];
+static bool s_affected[RGB_GFX_MAX_SPRITES];
+static rect_t s_dirty[RGB_GFX_MAX_SPRITES * 2];
+static int s_num_dirty;
+static uint32_t s_draw_seq;
+
+static inline bool rect_overlaps(const rect_t *a, const rect_t *b)
+{
+    return a->x0 < b->x1 && b->x0 < a->x1 && a->y0 < b->y1 && b->y0 < a->y1;
+}
+
+static inline bool rect_empty(const rect_t *r)
+{
+    return r->x0 >= r->x1 || r->y0 >= r->y1;
+}
+
+// Add a rectangle to the dirty list, merging it with anything it overlaps
+static void dirty_add(rect_t r)
+{
+    if (rect_empty(&r)) return;
+
+    bool merged;
+    do {
+        merged = false;
+        for (int i = 0; i < s_num_dirty; i++) {
+            if (rect_overlaps(&r, &s_dirty[i])) {
+                if (s_dirty[i].x0 < r.x0) r.x0 = s_dirty[i].x0;
+                if (s_dirty[i].y0 < r.y0) r.y0 = s_dirty[i].y0;
+                if (s_dirty[i].x1 > r.x1) r.x1 = s_dirty[i].x1;
+                if (s_dirty[i].y1 > r.y1) r.y1 = s_dirty[i].y1;
+                s_dirty[i] = s_dirty[--s_num_dirty];
+                merged = true;
+                break;
+            }
+        }
+    } while (merged);
+
+    s_dirty[s_num_dirty++] = r;
+}
+
+static bool dirty_overlaps(const rect_t *r)
+{
+    if (rect_empty(r)) return false;
+    for (int i = 0; i < s_num_dirty; i++) {
+        if (rect_overlaps(r, &s_dirty[i])) return true;
+    }
+    return false;
+}
+
+// Rectangle the sprite occupied at its last draw
+static rect_t old_rect(const rgb_gfx_sprite_t *s)
+{
+    if (!s->drawn.drawn) return (rect_t){ 0, 0, 0, 0 };
+    return (rect_t){ s->drawn.x, s->drawn.y, s->drawn.x + s->drawn.w, s->drawn.y + s->drawn.h };
+}
+
+// Rectangle the sprite will occupy, clipped to the framebuffer
+static rect_t new_rect(const rgb_gfx_sprite_t *s, int fb_w, int fb_h)
+{
+    if (!s->visible || !s->data || s->w <= 0 || s->h <= 0) return (rect_t){ 0, 0, 0, 0 };
+    rect_t r = { s->x, s->y, s->x + s->w, s->y + s->h };
+    if (r.x0 < 0) r.x0 = 0;
+    if (r.y0 < 0) r.y0 = 0;
+    if (r.x1 > fb_w) r.x1 = fb_w;
+    if (r.y1 > fb_h) r.y1 = fb_h;
+    if (rect_empty(&r)) return (rect_t){ 0, 0, 0, 0 };
+    return r;
+}
+
+static bool sprite_changed(const rgb_gfx_sprite_t *s, const rect_t *nr)
+{
+    if (s->dirty) return true;
+    if (s->drawn.drawn == rect_empty(nr)) return true;  // Appeared or disappeared
+    if (!s->drawn.drawn) return false;                  // Still not shown
+    return s->x != s->drawn.src_x || s->y != s->drawn.src_y || s->z != s->drawn.z ||
+           s->data != s->drawn.data ||
+           s->flip_x != s->drawn.flip_x || s->flip_y != s->drawn.flip_y;
+}
+
+static void sprite_restore(rgb_gfx_sprite_t *s)
+{
+    if (!s->drawn.drawn) return;
+    rgb_gfx_blit(s->save, s->drawn.x, s->drawn.y, s->drawn.w, s->drawn.h, s->drawn.w, -1);
+    s->drawn.drawn = false;
+}
+
+static void sprite_draw(rgb_gfx_sprite_t *s, const rect_t *r)
+{
+    int rw = r->x1 - r->x0, rh = r->y1 - r->y0;
+
+    // Save what is underneath (clipped), then draw
+    rgb_gfx_read_rect(r->x0, r->y0, rw, rh, s->save, rw);
+    if (s->flip_x || s->flip_y) {
+        rgb_gfx_blit_flip(s->data, s->x, s->y, s->w, s->h, s->stride, s->transparent,
+                          s->flip_x, s->flip_y);
+    } else {
+        rgb_gfx_blit(s->data, s->x, s->y, s->w, s->h, s->stride, s->transparent);
+    }
+
+    s->drawn.drawn = true;
+    s->drawn.x = r->x0;
+    s->drawn.y = r->y0;
+    s->drawn.w = rw;
+    s->drawn.h = rh;
+    s->drawn.data = s->data;
+    s->drawn.src_x = s->x;
+    s->drawn.src_y = s->y;
+    s->drawn.z = s->z;
+    s->drawn.flip_x = s->flip_x;
+    s->drawn.flip_y = s->flip_y;
+    s->drawn.seq = ++s_draw_seq;
+    s->dirty = false;
+}
+
+void rgb_gfx_sprites_update(rgb_gfx_sprite_t *sprites, int count, rgb_gfx_sprite_stats_t *stats)
+{
+    if (stats) memset(stats, 0, sizeof(*stats));
+    int fb_w = rgb_display_get_fb_width();
+    int fb_h = rgb_display_get_fb_height();
+    if (!sprites || count <= 0 || !rgb_display_get_framebuffer()) return;
+    if (rgb_display_get_fb_bpp() == 16) return;  // Save-under holds palette indices
+    if (count > RGB_GFX_MAX_SPRITES) count = RGB_GFX_MAX_SPRITES;
+
+    // Changed sprites seed the dirty area
+    s_num_dirty = 0;
+    for (int i = 0; i < count; i++) {
+        rect_t nr = new_rect(&sprites[i], fb_w, fb_h);
+        s_affected[i] = sprite_changed(&sprites[i], &nr);
+        if (s_affected[i]) {
+            dirty_add(old_rect(&sprites[i]));
+            dirty_add(nr);
+        }
+    }
+
+    // Anything touching the dirty area must be restored and redrawn too
+    bool grew;
+    do {
+        grew = false;
+        for (int i = 0; i < count; i++) {
+            if (s_affected[i]) continue;
+            rect_t orc = old_rect(&sprites[i]);
+            if (dirty_overlaps(&orc)) {
+                s_affected[i] = true;
+                dirty_add(orc);  // Unchanged sprite: new rect == old rect
+                grew = true;
+            }
+        }
+    } while (grew);
+
+    // Restore backgrounds, most recently drawn first
+    for (;;) {
+        int top = -1;
+        for (int i = 0; i < count; i++) {
+            if (s_affected[i] && sprites[i].drawn.drawn &&
+                (top < 0 || sprites[i].drawn.seq > sprites[top].drawn.seq)) {
+                top = i;
+            }
+        }
+        if (top < 0) break;
+        sprite_restore(&sprites[top]);
+    }
+
+    // Redraw in z order (stable insertion sort by z)
+    int n = 0;
+    for (int i = 0; i < count; i++) {
+        if (!s_affected[i]) continue;
+        int j = n++;
+        while (j > 0 && sprites[s_order[j - 1]].z > sprites[i].z) {
+            s_order[j] = s_order[j - 1];
+            j--;
+        }
+        s_order[j] = i;
+    }
+    for (int k = 0; k < n; k++) {
+        rgb_gfx_sprite_t *s = &sprites[s_order[k]];
+        rect_t nr = new_rect(s, fb_w, fb_h);
+        if (rect_empty(&nr) || !s->save) {
+            s->dirty = false;
+            continue;
+        }
+        sprite_draw(s, &nr);
+        if (stats) stats->sprites_drawn++;
+    }
+
+    if (stats) {
+        stats->dirty_rects = s_num_dirty;
+        for (int i = 0; i < s_num_dirty; i++) {
+            stats->dirty_pixels += (uint32_t)(s_dirty[i].x1 - s_dirty[i].x0) *
+                                   (uint32_t)(s_dirty[i].y1 - s_dirty[i].y0);
+        }
+    }
+}
+
+void rgb_gfx_sprites_erase(rgb_gfx_sprite_t *sprites, int count)
+{
+    if (!sprites || count <= 0 || rgb_display_get_fb_bpp() == 16) return;
+    if (count > RGB_GFX_MAX_SPRITES) count = RGB_GFX_MAX_SPRITES;
+
+    for (;;) {
+        int top = -1;
+        for (int i = 0; i < count; i++) {
+            if (sprites[i].drawn.drawn &&
+                (top < 0 || sprites[i].drawn.seq > sprites[top].drawn.seq)) {
+                top = i;
+            }
+        }
+        if (top < 0) break;
+        sprite_restore(&sprites[top]);
+    }
+}
+
+// --- Collision masks ---
+
+int rgb_gfx_mask_build(rgb_gfx_mask_t *mask, uint64_t *rows, const uint8_t *data,
+                       int w, int h, int stride, int transparent)
+{
+    if (!mask || !rows || !data || w <= 0 || h <= 0) return -1;
+    if (w > RGB_GFX_MASK_MAX_W) return -1;
+
+    mask->rows = rows;
+    mask->w = w;
+    mask->h = h;
+
+    for (int y = 0; y < h; y++) {
+        const uint8_t *src = &data[y * stride];
+        uint64_t bits = 0, mirrored = 0;
+        for (int x = 0; x < w; x++) {
+            if (src[x] != transparent) {
+                bits |= 1ULL << (63 - x);
+                mirrored |= 1ULL << (64 - w + x);
+            }
+        }
+        rows[y] = bits;
+        rows[h + y] = mirrored;
+    }
+    return 0;
+}
+
+int rgb_gfx_collide_flip(const rgb_gfx_mask_t *a, int ax, int ay, bool a_flip_x, bool a_flip_y,
+                         const rgb_gfx_mask_t *b, int bx, int by, bool b_flip_x, bool b_flip_y)
+{
+    if (!a || !b || !a->rows || !b->rows) return -1;
+
+    // Bounding boxes first
+    int dx = bx - ax;
+    if (dx >= a->w || -dx >= b->w) return -1;
+    int y0 = ay > by ? ay : by;
+    int y1 = (ay + a->h < by + b->h) ? ay + a->h : by + b->h;
+    if (y0 >= y1) return -1;
+
+    const uint64_t *ra = a->rows + (a_flip_x ? a->h : 0);
+    const uint64_t *rb = b->rows + (b_flip_x ? b->h : 0);
+
+    // Bring b into a's bit frame: |dx| < 64 here since both widths are <= 64
+    int shr = dx > 0 ? dx : 0;
+    int shl = dx < 0 ? -dx : 0;
+
+    for (int y = y0; y < y1; y++) {
+        int ya = y - ay, yb = y - by;
+        uint64_t wa = ra[a_flip_y ? a->h - 1 - ya : ya];
+        uint64_t wb = rb[b_flip_y ? b->h - 1 - yb : yb];
+        if (wa & ((wb >> shr) << shl)) return ya;
+    }
+    return -1;
+}
+
+int rgb_gfx_collide(const rgb_gfx_mask_t *a, int ax, int ay,
+                    const rgb_gfx_mask_t *b, int bx, int by)
+{
+    return rgb_gfx_collide_flip(a, ax, ay, false, false, b, bx, by, false, false);
+}